@@ -0,0 +1,55 @@
+#!/usr/bin/python3
+
+# Turn the output of main.py into link presets for xrdndn-wan-bench.
+#
+# main.py prints "source,destination,average bandwidth" lines, with the
+# average perfSONAR throughput in bits/s, mixed with progress messages. RTTs
+# are not part of that output, thus they are read from an optional CSV file
+# with "source,destination,rtt_ms" lines or a default RTT is used.
+#
+# Usage:
+#   python3 main.py > bw.csv
+#   python3 make_wan_presets.py -b bw.csv [-r rtt.csv] -o presets.csv
+#   xrdndn-wan-bench --presets=presets.csv
+
+import argparse
+import sys
+
+
+def read_pairs(path, min_fields=3):
+    pairs = {}
+    with open(path) as f:
+        for line in f:
+            fields = [x.strip() for x in line.split(',')]
+            if len(fields) < min_fields:
+                continue
+            try:
+                pairs[(fields[0], fields[1])] = float(fields[2])
+            except ValueError:
+                # Header and progress lines
+                continue
+    return pairs
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Generate xrdndn-wan-bench link presets from cms_topology measurements')
+    parser.add_argument('-b', '--bandwidth', required=True, help='output of main.py: source,destination,bits/s')
+    parser.add_argument('-r', '--rtt', help='CSV file with source,destination,rtt_ms lines')
+    parser.add_argument('--default-rtt', type=float, default=50.0, help='RTT in ms of site pairs missing from the RTT file (default: 50)')
+    parser.add_argument('--loss', type=float, default=0.0, help='packet loss probability of every link (default: 0)')
+    parser.add_argument('--reorder', type=float, default=0.0, help='packet reordering probability of every link (default: 0)')
+    parser.add_argument('-o', '--output', help='presets file (default: stdout)')
+    args = parser.parse_args()
+
+    bandwidths = read_pairs(args.bandwidth)
+    rtts = read_pairs(args.rtt) if args.rtt else {}
+    if not bandwidths:
+        sys.exit('No bandwidth measurements found in {0:s}'.format(args.bandwidth))
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    out.write('# name,rtt_ms,bandwidth_mbps,loss,reorder\n')
+    for (source, destination), bw in sorted(bandwidths.items()):
+        rtt = rtts.get((source, destination), rtts.get((destination, source), args.default_rtt))
+        out.write('{0:s}-{1:s},{2:.3f},{3:.3f},{4:g},{5:g}\n'.format(source, destination, rtt, bw / 1e6, args.loss, args.reorder))
+    if out is not sys.stdout:
+        out.close()
@@ -0,0 +1,201 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/xrdndn-consumer/xrdndn-countdown-latch.hh"
+#include "../src/xrdndn-consumer/xrdndn-slot-pool.hh"
+
+/**
+ * @brief Compare the bookkeeping done for every segment of a read request:
+ * a task, a future and a window map entry per segment against pooled fetch
+ * slots and one countdown latch per request. Both designs are modeled by
+ * stand-in classes and the NDN face is left out, each Interest is completed
+ * right after it is inserted. Thus allocs/segment only counts the completion
+ * tracking and does not mean that reading a segment allocates nothing. The
+ * allocations of the whole read path, Interest and face included, are counted
+ * by BM_PipelineInsert and BM_ConsumerRead in xrdndn-hot-path-bench
+ *
+ */
+
+static std::atomic<uint64_t> g_nAllocs(0);
+
+// Count every heap allocation. Not inlined, so that the compiler does not pair
+// malloc/free with new/delete and warn about a mismatch
+__attribute__((noinline)) void *operator new(size_t size) {
+    ++g_nAllocs;
+    if (void *p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * @brief Stand-in for ndn::Block. Content is shared, never copied
+ *
+ */
+struct Content {
+    std::shared_ptr<const std::vector<uint8_t>> buffer;
+};
+
+static const size_t PIPELINE_SIZE = 64;
+
+/*****************************************************************************/
+/*                  P e r - s e g m e n t   f u t u r e s                    */
+/*****************************************************************************/
+struct Result {
+    int errcode;
+    Content content;
+};
+
+class FutureFetcher {
+  public:
+    FutureFetcher(std::function<void()> onSuccess)
+        : m_onSuccess(std::move(onSuccess)),
+          m_task([](int errcode, const Content &content) {
+              return Result{errcode, content};
+          }) {}
+
+    std::future<Result> get_future() { return m_task.get_future(); }
+
+    void complete(const Content &content) {
+        m_task(0, content);
+        m_onSuccess();
+    }
+
+  private:
+    std::function<void()> m_onSuccess;
+    std::packaged_task<Result(int, const Content &)> m_task;
+};
+
+static void BM_PerSegmentFutures(benchmark::State &state) {
+    const size_t nSegments = state.range(0);
+    const Content content{std::make_shared<std::vector<uint8_t>>(7168)};
+    std::unordered_map<uint64_t, std::shared_ptr<FutureFetcher>> window;
+    std::vector<std::future<Result>> futures;
+    futures.reserve(nSegments);
+    uint64_t pipeNo = 0, nBytes = 0;
+
+    uint64_t nAllocs = g_nAllocs;
+    for (auto _ : state) {
+        futures.clear();
+        for (size_t i = 0; i < nSegments; ++i) {
+            uint64_t no = pipeNo++;
+            auto fetcher = std::make_shared<FutureFetcher>(
+                std::bind([&window](uint64_t no) { window.erase(no); }, no));
+            window.emplace(no, fetcher);
+            futures.emplace_back(fetcher->get_future());
+            fetcher->complete(content);
+        }
+
+        for (auto &future : futures)
+            nBytes += future.get().content.buffer->size();
+    }
+    nAllocs = g_nAllocs - nAllocs;
+
+    benchmark::DoNotOptimize(nBytes);
+    state.SetItemsProcessed(state.iterations() * nSegments);
+    state.counters["allocs/segment"] = static_cast<double>(nAllocs) /
+                                       (state.iterations() * nSegments);
+}
+BENCHMARK(BM_PerSegmentFutures)->Arg(1)->Arg(16)->Arg(128);
+
+/*****************************************************************************/
+/*                  P o o l e d   s l o t s   +   l a t c h                  */
+/*****************************************************************************/
+class Completion {
+  public:
+    virtual ~Completion() = default;
+    virtual void onComplete(uint64_t segmentNo, const Content &content) = 0;
+};
+
+class SlotFetcher {
+  public:
+    void fetch(uint64_t segmentNo, Completion *completion) {
+        m_segmentNo = segmentNo;
+        m_completion = completion;
+    }
+
+    void complete(const Content &content) {
+        m_completion->onComplete(m_segmentNo, content);
+    }
+
+  private:
+    uint64_t m_segmentNo = 0;
+    Completion *m_completion = nullptr;
+};
+
+class Request : public Completion {
+  public:
+    void onComplete(uint64_t, const Content &content) override {
+        nBytes += content.buffer->size();
+        latch.countDown();
+    }
+
+    std::atomic<uint64_t> nBytes{0};
+    xrdndnconsumer::CountdownLatch latch;
+};
+
+static void BM_PooledSlotsLatch(benchmark::State &state) {
+    const size_t nSegments = state.range(0);
+    const Content content{std::make_shared<std::vector<uint8_t>>(7168)};
+    xrdndnconsumer::SlotPool<SlotFetcher> pool(PIPELINE_SIZE);
+    uint64_t nBytes = 0;
+
+    uint64_t nAllocs = g_nAllocs;
+    for (auto _ : state) {
+        Request request;
+        for (size_t i = 0; i < nSegments; ++i) {
+            auto fetcher = pool.acquire();
+            request.latch.add();
+            fetcher->fetch(i, &request);
+            fetcher->complete(content);
+            pool.release(fetcher);
+        }
+
+        request.latch.wait();
+        nBytes += request.nBytes;
+    }
+    nAllocs = g_nAllocs - nAllocs;
+
+    benchmark::DoNotOptimize(nBytes);
+    state.SetItemsProcessed(state.iterations() * nSegments);
+    state.counters["allocs/segment"] = static_cast<double>(nAllocs) /
+                                       (state.iterations() * nSegments);
+}
+BENCHMARK(BM_PooledSlotsLatch)->Arg(1)->Arg(16)->Arg(128);
+
+BENCHMARK_MAIN();
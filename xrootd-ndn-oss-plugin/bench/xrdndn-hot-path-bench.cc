@@ -0,0 +1,339 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/common/xrdndn-utils.hh"
+#include "../src/xrdndn-consumer/xrdndn-consumer.hh"
+#include "../src/xrdndn-consumer/xrdndn-countdown-latch.hh"
+#include "../src/xrdndn-producer/xrdndn-file-handler.hh"
+#include "../src/xrdndn-producer/xrdndn-packager.hh"
+#include "xrdndn-loopback.hh"
+
+/**
+ * @brief Microbenchmarks of the code that runs once per segment: Data
+ * packaging and reading on the Producer, Name construction and parsing, and
+ * the Pipeline and Consumer read paths. The Consumer side is served by an
+ * in-memory face that answers every Interest with prebuilt Data, so only the
+ * Consumer's own work is measured. The Consumer benchmarks also report the
+ * heap allocations done per segment, Interest encoding and face included.
+ * Requests carry no Name and DataFetchers reuse their Interest, but ndn-cxx
+ * still allocates to encode and to express each Interest, so the count does
+ * not drop to zero
+ * Run through the bench target to export the results as JSON
+ *
+ */
+
+static std::atomic<uint64_t> g_nAllocs(0);
+
+// Count every heap allocation, on all threads, so that the allocations done
+// by the Face thread for a segment are counted too
+__attribute__((noinline)) void *operator new(size_t size) {
+    ++g_nAllocs;
+    if (void *p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static const std::string FILE_PATH = "/store/mc/RunIIFall17/file.root";
+// Served by Responder, the content is generated once and never read from disk
+static const std::string SYNTHETIC_PATH = "/synthetic/16M/1";
+static const uint64_t SYNTHETIC_SIZE = 16 << 20;
+static const uint64_t SYNTHETIC_SEGMENTS =
+    (SYNTHETIC_SIZE + XRDNDN_MAX_NDN_PACKET_SIZE - 1) /
+    XRDNDN_MAX_NDN_PACKET_SIZE;
+
+/*****************************************************************************/
+/*                              P r o d u c e r                              */
+/*****************************************************************************/
+static void BM_PackagerGetPackage(benchmark::State &state) {
+    xrdndnproducer::Packager packager(32000, 32000, state.range(0) == 0);
+    ndn::Name name = xrdndn::Utils::getName(xrdndn::SYS_CALL_READ_PREFIX_URI,
+                                            FILE_PATH, 42);
+    std::array<uint8_t, XRDNDN_MAX_NDN_PACKET_SIZE> payload;
+    payload.fill(0xAB);
+
+    for (auto _ : state) {
+        auto data = packager.getPackage(name, payload.data(), payload.size());
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_PackagerGetPackage)->ArgName("signing")->Arg(0)->Arg(1);
+
+static void BM_FileHandlerGetReadData(benchmark::State &state) {
+    const uint64_t fileSize = 64 << 20;
+    const uint64_t nSegments = fileSize / XRDNDN_MAX_NDN_PACKET_SIZE;
+    auto packager =
+        std::make_shared<xrdndnproducer::Packager>(32000, 32000, true);
+    xrdndnproducer::FileHandler fileHandler(getBenchFile(fileSize), packager);
+
+    std::vector<ndn::Name> names;
+    names.reserve(nSegments);
+    for (uint64_t i = 0; i < nSegments; ++i)
+        names.push_back(xrdndn::Utils::getName(
+            xrdndn::SYS_CALL_READ_PREFIX_URI, FILE_PATH, i));
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        auto data = fileHandler.getReadData(names[i++ % nSegments]);
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(state.iterations() * XRDNDN_MAX_NDN_PACKET_SIZE);
+}
+BENCHMARK(BM_FileHandlerGetReadData);
+
+/*****************************************************************************/
+/*                                 U t i l s                                 */
+/*****************************************************************************/
+static void BM_UtilsGetName(benchmark::State &state) {
+    uint64_t segmentNo = 0;
+    for (auto _ : state) {
+        auto name = xrdndn::Utils::getName(xrdndn::SYS_CALL_READ_PREFIX_URI,
+                                           FILE_PATH, segmentNo++);
+        benchmark::DoNotOptimize(name);
+    }
+}
+BENCHMARK(BM_UtilsGetName);
+
+static void BM_UtilsGetPath(benchmark::State &state) {
+    const auto name = xrdndn::Utils::getName(xrdndn::SYS_CALL_READ_PREFIX_URI,
+                                             FILE_PATH, 42);
+    for (auto _ : state) {
+        auto path = xrdndn::Utils::getPath(name);
+        benchmark::DoNotOptimize(path);
+    }
+}
+BENCHMARK(BM_UtilsGetPath);
+
+static void BM_UtilsGetSegmentNo(benchmark::State &state) {
+    const auto name = xrdndn::Utils::getName(xrdndn::SYS_CALL_READ_PREFIX_URI,
+                                             FILE_PATH, 42);
+    for (auto _ : state) {
+        auto segmentNo = xrdndn::Utils::getSegmentNo(name);
+        benchmark::DoNotOptimize(segmentNo);
+    }
+}
+BENCHMARK(BM_UtilsGetSegmentNo);
+
+static void BM_UtilsGetFileHash(benchmark::State &state) {
+    const auto name = xrdndn::Utils::getName(xrdndn::SYS_CALL_READ_PREFIX_URI,
+                                             FILE_PATH, 42);
+    for (auto _ : state) {
+        auto hash = xrdndn::Utils::getFileHash(name);
+        benchmark::DoNotOptimize(hash);
+    }
+}
+BENCHMARK(BM_UtilsGetFileHash);
+
+static void BM_UtilsAppendSegment(benchmark::State &state) {
+    const auto prefix = xrdndn::Utils::getFilePrefix(
+        xrdndn::SYS_CALL_READ_PREFIX_URI, FILE_PATH);
+    uint64_t segmentNo = 0;
+    for (auto _ : state) {
+        auto name = ndn::Name(prefix).appendSegment(segmentNo++);
+        benchmark::DoNotOptimize(name);
+    }
+}
+BENCHMARK(BM_UtilsAppendSegment);
+
+/*****************************************************************************/
+/*                              C o n s u m e r                              */
+/*****************************************************************************/
+/**
+ * @brief In-memory face that answers every Interest for SYNTHETIC_PATH with
+ * Data built once up front, and a Consumer session running on it
+ *
+ */
+class Responder {
+  public:
+    Responder(const xrdndnconsumer::Options &opts)
+        : m_face(m_ioService, {false, false}),
+          m_packager(
+              std::make_shared<xrdndnproducer::Packager>(32000, 32000, true)),
+          m_fileHandler(SYNTHETIC_PATH, m_packager, true) {
+        for (uint64_t i = 0; i < SYNTHETIC_SEGMENTS; ++i) {
+            auto name = xrdndn::Utils::getName(
+                xrdndn::SYS_CALL_READ_PREFIX_URI, SYNTHETIC_PATH, i);
+            m_segments.push_back(m_fileHandler.getReadData(name));
+        }
+
+        m_connection =
+            m_face.onSendInterest.connect([this](const ndn::Interest &i) {
+                auto data = getData(i.getName());
+                m_ioService.post([this, data]() { m_face.receive(*data); });
+            });
+        m_session = xrdndnconsumer::Session::getSession(opts, m_face);
+    }
+
+    ~Responder() {
+        if (m_session)
+            m_session->stop();
+    }
+
+    std::shared_ptr<xrdndnconsumer::Session> getSession() { return m_session; }
+
+  private:
+    std::shared_ptr<ndn::Data> getData(ndn::Name name) {
+        if (xrdndn::SYS_CALL_READ_PREFIX_URI.isPrefixOf(name))
+            return m_segments[xrdndn::Utils::getSegmentNo(name) %
+                              SYNTHETIC_SEGMENTS];
+        if (xrdndn::SYS_CALL_FSTAT_PREFIX_URI.isPrefixOf(name))
+            return m_fileHandler.getFstatData(name);
+        return m_fileHandler.getOpenData(name);
+    }
+
+  private:
+    boost::asio::io_service m_ioService;
+    ndn::util::DummyClientFace m_face;
+    ndn::util::signal::ScopedConnection m_connection;
+
+    std::shared_ptr<xrdndnproducer::Packager> m_packager;
+    xrdndnproducer::FileHandler m_fileHandler;
+    std::vector<std::shared_ptr<ndn::Data>> m_segments;
+
+    std::shared_ptr<xrdndnconsumer::Session> m_session;
+};
+
+/**
+ * @brief Counts down once per completed segment
+ *
+ */
+struct LatchCompletion : xrdndnconsumer::FetchCompletion {
+    void onComplete(uint64_t, int errcode, const ndn::Block &) override {
+        if (errcode != XRDNDN_ESUCCESS)
+            failed = true;
+        latch.countDown();
+    }
+
+    xrdndnconsumer::CountdownLatch latch;
+    std::atomic<bool> failed{false};
+};
+
+static void BM_PipelineInsert(benchmark::State &state) {
+    const size_t nSegments = 1024;
+
+    xrdndnconsumer::Options opts;
+    opts.pipelineSize = state.range(0);
+    opts.logLevel = "NONE";
+
+    Responder responder(opts);
+    if (!responder.getSession()) {
+        state.SkipWithError("Unable to start Consumer session");
+        return;
+    }
+    auto &pipeline = responder.getSession()->getPipeline();
+
+    // As the Consumer does: one shared prefix, the DataFetchers append the
+    // segment number
+    xrdndnconsumer::InterestSpec spec;
+    spec.prefix =
+        std::make_shared<const ndn::Name>(xrdndn::Utils::getFilePrefix(
+            xrdndn::SYS_CALL_READ_PREFIX_URI, SYNTHETIC_PATH));
+    spec.mustBeFresh = false;
+    spec.lifetime = ndn::time::seconds(4);
+
+    LatchCompletion completion;
+    uint64_t nAllocs = g_nAllocs;
+    for (auto _ : state) {
+        completion.latch.add(nSegments);
+        for (uint64_t i = 0; i < nSegments; ++i) {
+            if (!pipeline.insert(spec, i, &completion))
+                completion.latch.countDown();
+        }
+        completion.latch.wait();
+
+        if (completion.failed) {
+            state.SkipWithError("Segment fetch failed");
+            break;
+        }
+    }
+    nAllocs = g_nAllocs - nAllocs;
+
+    state.SetItemsProcessed(state.iterations() * nSegments);
+    state.counters["allocs/segment"] = static_cast<double>(nAllocs) /
+                                       (state.iterations() * nSegments);
+}
+BENCHMARK(BM_PipelineInsert)
+    ->ArgName("pipeline")
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(256)
+    ->UseRealTime();
+
+static void BM_ConsumerRead(benchmark::State &state) {
+    const size_t bsize = state.range(0);
+
+    xrdndnconsumer::Options opts;
+    opts.logLevel = "NONE";
+
+    Responder responder(opts);
+    auto consumer = xrdndnconsumer::Consumer::getXrdNdnConsumerInstance(
+        opts, responder.getSession());
+    if (!consumer || consumer->Open(SYNTHETIC_PATH) != XRDNDN_ESUCCESS) {
+        state.SkipWithError("Unable to open synthetic file");
+        return;
+    }
+
+    std::vector<char> buff(bsize);
+    uint64_t offset = 0, nSegments = 0;
+    uint64_t nAllocs = g_nAllocs;
+    for (auto _ : state) {
+        auto retRead = consumer->Read(buff.data(), offset, bsize);
+        if (retRead <= 0) {
+            state.SkipWithError("Read failed");
+            break;
+        }
+        nSegments += (offset + retRead - 1) / XRDNDN_MAX_NDN_PACKET_SIZE -
+                     offset / XRDNDN_MAX_NDN_PACKET_SIZE + 1;
+        offset = (offset + bsize) % SYNTHETIC_SIZE;
+    }
+    // Readahead still in flight is not waited for, so the count is per
+    // segment copied to the reader
+    nAllocs = g_nAllocs - nAllocs;
+    consumer->Close();
+
+    state.SetBytesProcessed(state.iterations() * bsize);
+    if (nSegments > 0)
+        state.counters["allocs/segment"] =
+            static_cast<double>(nAllocs) / nSegments;
+}
+BENCHMARK(BM_ConsumerRead)
+    ->ArgName("bsize")
+    ->Arg(XRDNDN_MAX_NDN_PACKET_SIZE)
+    ->Arg(64 << 10)
+    ->Arg(1 << 20)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
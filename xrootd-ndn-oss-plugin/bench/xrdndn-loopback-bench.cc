@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include "../src/xrdndn-consumer/xrdndn-consumer.hh"
+#include "xrdndn-loopback.hh"
+
+/**
+ * @brief End-to-end transfer of a file between Consumer and Producer in one
+ * process. Both run over DummyClientFace instances that are linked to each
+ * other and share one io_service, so there is no forwarder and no socket in
+ * the path and results are reproducible on any machine. Sweeps file size,
+ * pipeline size, Producer threads and signing, and reports throughput and the
+ * CPU time of the whole process per GB transferred
+ *
+ */
+
+static void BM_Loopback(benchmark::State &state) {
+    const uint64_t fileSize = state.range(0);
+    const std::string path = getBenchFile(fileSize);
+
+    xrdndnconsumer::Options consumerOpts;
+    consumerOpts.pipelineSize = state.range(1);
+    consumerOpts.logLevel = "NONE";
+
+    xrdndnproducer::Options producerOpts;
+    producerOpts.nthreads = state.range(2);
+    producerOpts.disableSigning = state.range(3) == 0;
+    producerOpts.gbTimer = std::chrono::seconds(producerOpts.gbTimePeriod);
+
+    Loopback loopback(consumerOpts, producerOpts);
+    if (!loopback.getSession()) {
+        state.SkipWithError("Unable to connect Consumer and Producer");
+        return;
+    }
+
+    std::vector<char> buff(READ_SIZE);
+    uint64_t nBytes = 0;
+    double cpuSeconds = getProcessCpuSeconds();
+
+    for (auto _ : state) {
+        auto consumer = xrdndnconsumer::Consumer::getXrdNdnConsumerInstance(
+            consumerOpts, loopback.getSession());
+        if (!consumer || consumer->Open(path) != XRDNDN_ESUCCESS) {
+            state.SkipWithError("Unable to open file over loopback");
+            break;
+        }
+
+        for (uint64_t offset = 0; offset < fileSize; offset += READ_SIZE) {
+            auto retRead = consumer->Read(
+                buff.data(), offset,
+                std::min<uint64_t>(READ_SIZE, fileSize - offset));
+            if (retRead <= 0) {
+                state.SkipWithError("Read failed over loopback");
+                break;
+            }
+            nBytes += retRead;
+        }
+
+        consumer->Close();
+    }
+
+    cpuSeconds = getProcessCpuSeconds() - cpuSeconds;
+    state.SetBytesProcessed(nBytes);
+    if (nBytes > 0)
+        state.counters["cpu_s/GB"] = cpuSeconds / (nBytes / 1e9);
+}
+BENCHMARK(BM_Loopback)
+    ->ArgNames({"file_size", "pipeline", "producer_threads", "signing"})
+    ->ArgsProduct({{1 << 20, 64 << 20}, {16, 64, 256}, {1, 8}, {0, 1}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
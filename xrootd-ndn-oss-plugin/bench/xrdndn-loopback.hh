@@ -0,0 +1,136 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_LOOPBACK_HH
+#define XRDNDN_LOOPBACK_HH
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include "../src/xrdndn-consumer/xrdndn-session.hh"
+#include "../src/xrdndn-producer/xrdndn-producer.hh"
+#include "xrdndn-wan-link.hh"
+
+static const size_t READ_SIZE = 1048576;
+
+inline std::string getBenchFileDir() {
+    // Keep the Producer's reads off the disk when tmpfs is available
+    return access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+}
+
+/**
+ * @brief Get the path of a file of the given size filled with pseudo-random
+ * bytes. It is created on first use and removed when the benchmark exits
+ *
+ */
+inline std::string getBenchFile(uint64_t size) {
+    static std::vector<std::string> files;
+    std::string path = getBenchFileDir() + "/xrdndn-bench-" +
+                       std::to_string(getpid()) + "-" + std::to_string(size);
+    if (std::find(files.begin(), files.end(), path) != files.end())
+        return path;
+
+    std::ofstream file(path, std::ofstream::binary);
+    std::mt19937_64 random(size);
+    std::vector<uint64_t> block(READ_SIZE / sizeof(uint64_t));
+    for (uint64_t written = 0; written < size; written += READ_SIZE) {
+        for (auto &word : block)
+            word = random();
+        file.write(reinterpret_cast<const char *>(block.data()),
+                   std::min<uint64_t>(READ_SIZE, size - written));
+    }
+
+    if (files.empty())
+        std::atexit([]() {
+            for (auto &file : files)
+                unlink(file.c_str());
+        });
+    files.push_back(path);
+    return path;
+}
+
+inline double getProcessCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+/**
+ * @brief Producer and Consumer session connected through in-memory faces,
+ * either linked directly or through an emulated WAN link. The Consumer session
+ * runs the shared io_service
+ *
+ */
+class Loopback {
+  public:
+    Loopback(const xrdndnconsumer::Options &consumerOpts,
+             const xrdndnproducer::Options &producerOpts,
+             const WanLinkParams *wanLinkParams = nullptr)
+        : m_producerFace(m_ioService, {false, true}),
+          m_consumerFace(m_ioService, {false, true}) {
+        if (wanLinkParams)
+            m_wanLink = std::make_unique<WanLink>(
+                m_ioService, m_consumerFace, m_producerFace, *wanLinkParams);
+        else
+            m_consumerFace.linkTo(m_producerFace);
+
+        // The Producer processes pending events once, thus it must be created
+        // before the Consumer session starts its event loop
+        m_producer = xrdndnproducer::Producer::getXrdNdnProducerInstance(
+            m_producerFace, producerOpts);
+        if (m_producer)
+            m_session = xrdndnconsumer::Session::getSession(consumerOpts,
+                                                            m_consumerFace);
+    }
+
+    ~Loopback() {
+        m_ioService.stop();
+        if (m_session)
+            m_session->stop();
+        m_session.reset();
+        m_producer.reset();
+    }
+
+    std::shared_ptr<xrdndnconsumer::Session> getSession() { return m_session; }
+
+    const WanLink *getWanLink() const { return m_wanLink.get(); }
+
+  private:
+    boost::asio::io_service m_ioService;
+    ndn::util::DummyClientFace m_producerFace;
+    ndn::util::DummyClientFace m_consumerFace;
+    std::unique_ptr<WanLink> m_wanLink;
+
+    std::shared_ptr<xrdndnproducer::Producer> m_producer;
+    std::shared_ptr<xrdndnconsumer::Session> m_session;
+};
+
+#endif // XRDNDN_LOOPBACK_HH
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Two-stage profile guided optimization build of the XRootD NDN plugin,
+# Producer and Consumer, trained on the loopback benchmark, and the measured
+# throughput gain over a plain Release build.
+#
+# Usage: bench/xrdndn-pgo-build.sh [build directory] [extra cmake arguments]
+# Example: bench/xrdndn-pgo-build.sh build-pgo -DXRDNDN_ENABLE_LTO=ON
+#
+# The optimized binaries are left in the build directory and can be installed
+# from there. All stages must run in the same directory: GCC matches profiles
+# by object file path.
+
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=$(mkdir -p "${1:-build-pgo}" && cd "${1:-build-pgo}" && pwd)
+shift || true
+JOBS=$(nproc)
+
+CMAKE_ARGS=(-DCMAKE_BUILD_TYPE=Release -DXRDNDN_BUILD_BENCHMARKS=ON "$@")
+FILTER="BM_Loopback/file_size:67108864/"
+
+configure_and_build() {
+    (cd "$BUILD_DIR" && cmake "$SOURCE_DIR" "${CMAKE_ARGS[@]}" -DXRDNDN_PGO="$1")
+    cmake --build "$BUILD_DIR" -- -j"$JOBS"
+}
+
+run_benchmark() {
+    "$BUILD_DIR/xrdndn-loopback-bench" --benchmark_filter="$FILTER" \
+        --benchmark_out="$BUILD_DIR/$1" --benchmark_out_format=json
+}
+
+echo "==> Stage 0: Release build without profile"
+configure_and_build ""
+run_benchmark pgo-baseline.json
+
+echo "==> Stage 1: instrumented build and training"
+rm -rf "$BUILD_DIR/pgo-profile"
+configure_and_build GENERATE
+cmake --build "$BUILD_DIR" --target pgo-train
+
+echo "==> Stage 2: build optimized with the profile"
+configure_and_build USE
+run_benchmark pgo-optimized.json
+
+python3 - "$BUILD_DIR/pgo-baseline.json" "$BUILD_DIR/pgo-optimized.json" <<'PY'
+import json
+import sys
+
+def throughput(path):
+    with open(path) as f:
+        return {b['name']: b['bytes_per_second'] for b in json.load(f)['benchmarks'] if 'bytes_per_second' in b}
+
+baseline = throughput(sys.argv[1])
+optimized = throughput(sys.argv[2])
+
+print('{0:70s} {1:>12s} {2:>12s} {3:>8s}'.format('benchmark', 'base MB/s', 'pgo MB/s', 'gain'))
+for name, base in sorted(baseline.items()):
+    if name in optimized and base > 0:
+        print('{0:70s} {1:12.1f} {2:12.1f} {3:+7.1f}%'.format(name, base / 1e6, optimized[name] / 1e6, 100 * (optimized[name] / base - 1)))
+PY
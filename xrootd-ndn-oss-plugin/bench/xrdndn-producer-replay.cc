@@ -0,0 +1,687 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+
+#include "../src/common/xrdndn-logger.hh"
+#include "../src/common/xrdndn-namespace.hh"
+#include "../src/common/xrdndn-utils.hh"
+#include "../src/xrdndn-consumer/xrdndn-latency-histogram.hh"
+#include "../src/xrdndn-producer/xrdndn-interest-manager.hh"
+#include "../src/xrdndn-producer/xrdndn-producer.hh"
+
+/**
+ * @brief Producer load generator. Replays a recorded or synthetic Interest
+ * trace either straight into the InterestManager or through a Producer on an
+ * in-memory face, for each requested number of Producer threads, and reports
+ * Data/s, per request latency, CPU time of every worker thread, context
+ * switches and disk reads. Comparing the runs shows at which thread count the
+ * Producer stops scaling and hints at why: busy workers mean CPU bound (e.g.
+ * signing, see --compare-signing), idle workers with many voluntary context
+ * switches mean lock contention and disk reads mean I/O bound.
+ *
+ * Trace file lines: time_us,call,path[,segment] where call is one of open,
+ * fstat, read or openstat and time_us is the arrival time of the Interest
+ * relative to the start of the trace. Lines starting with '#' are ignored
+ *
+ */
+
+namespace xrdndnproducer {
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief One Interest of a trace
+ *
+ */
+struct TraceEntry {
+    enum class Call { OPEN, FSTAT, READ, OPENSTAT };
+
+    uint64_t timeUs;
+    Call call;
+    ndn::Interest interest;
+};
+
+struct ReplayOptions {
+    std::string traceFile;
+    std::string syntheticFile;
+    uint64_t nRequests = 100000;
+    size_t nClients = 16;
+    double rate = 0;
+    double speed = 1;
+    size_t maxOutstanding = 1024;
+    std::string nthreads = "1,2,4,8,16";
+    bool throughFace = false;
+    bool compareSigning = false;
+    uint64_t drainTimeout = 10;
+};
+
+/**
+ * @brief Outcome of replaying a trace once
+ *
+ */
+struct ReplayResult {
+    uint16_t nthreads = 0;
+    bool signing = false;
+    double wallSeconds = 0;
+    uint64_t nData = 0;
+    uint64_t nBytes = 0;
+    uint64_t nLost = 0;
+    xrdndnconsumer::LatencyHistogram latency;
+    double cpuSeconds = 0;
+    double workerUtilMean = 0;
+    double workerUtilMax = 0;
+    long nVoluntarySwitches = 0;
+    long nInvoluntarySwitches = 0;
+    // -1 when /proc/self/io is not readable
+    double diskMBytes = -1;
+};
+
+static TraceEntry getTraceEntry(uint64_t timeUs, TraceEntry::Call call,
+                                const std::string &path, uint64_t segmentNo) {
+    static const std::map<TraceEntry::Call, ndn::Name> prefixes = {
+        {TraceEntry::Call::OPEN, xrdndn::SYS_CALL_OPEN_PREFIX_URI},
+        {TraceEntry::Call::FSTAT, xrdndn::SYS_CALL_FSTAT_PREFIX_URI},
+        {TraceEntry::Call::READ, xrdndn::SYS_CALL_READ_PREFIX_URI},
+        {TraceEntry::Call::OPENSTAT, xrdndn::SYS_CALL_OPEN_STAT_PREFIX_URI}};
+
+    return {timeUs, call,
+            ndn::Interest(xrdndn::Utils::getName(prefixes.at(call), path,
+                                                 segmentNo))};
+}
+
+/**
+ * @brief Read a trace file
+ *
+ * @return bool True if the trace was read and is not empty
+ */
+static bool readTrace(const std::string &traceFile,
+                      std::vector<TraceEntry> &trace) {
+    static const std::map<std::string, TraceEntry::Call> calls = {
+        {"open", TraceEntry::Call::OPEN},
+        {"fstat", TraceEntry::Call::FSTAT},
+        {"read", TraceEntry::Call::READ},
+        {"openstat", TraceEntry::Call::OPENSTAT}};
+
+    std::ifstream file(traceFile);
+    if (!file) {
+        std::cerr << "ERROR: Unable to open trace file: " << traceFile
+                  << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (size_t lineNo = 1; std::getline(file, line); ++lineNo) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::stringstream ss(line);
+        std::vector<std::string> fields;
+        for (std::string field; std::getline(ss, field, ',');)
+            fields.push_back(field);
+
+        try {
+            if (fields.size() < 3 || calls.count(fields[1]) == 0)
+                throw std::invalid_argument(line);
+
+            trace.push_back(getTraceEntry(
+                std::stoull(fields[0]), calls.at(fields[1]), fields[2],
+                fields.size() > 3 ? std::stoull(fields[3]) : 0));
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: Invalid trace line " << lineNo << ": " << line
+                      << std::endl;
+            return false;
+        }
+    }
+
+    std::stable_sort(trace.begin(), trace.end(),
+                     [](const TraceEntry &a, const TraceEntry &b) {
+                         return a.timeUs < b.timeUs;
+                     });
+    return !trace.empty();
+}
+
+/**
+ * @brief Synthesize the trace of many clients that open the same file, stat
+ * it and then read it sequentially, each one from a different offset. The
+ * clients are interleaved and the Interests are evenly spaced at the given
+ * rate, or all due at once if the rate is 0
+ *
+ */
+static bool getSyntheticTrace(const ReplayOptions &opts,
+                              std::vector<TraceEntry> &trace) {
+    struct stat info;
+    if (stat(opts.syntheticFile.c_str(), &info) != 0 || info.st_size == 0) {
+        std::cerr << "ERROR: Unable to stat non-empty file: "
+                  << opts.syntheticFile << std::endl;
+        return false;
+    }
+
+    const uint64_t nSegments =
+        (info.st_size + XRDNDN_MAX_NDN_PACKET_SIZE - 1) /
+        XRDNDN_MAX_NDN_PACKET_SIZE;
+    const double intervalUs = opts.rate > 0 ? 1e6 / opts.rate : 0;
+    std::vector<uint64_t> nextSegment(opts.nClients);
+    for (size_t i = 0; i < opts.nClients; ++i)
+        nextSegment[i] = i * nSegments / opts.nClients;
+
+    trace.reserve(opts.nRequests);
+    for (uint64_t i = 0; i < opts.nRequests; ++i) {
+        size_t client = i % opts.nClients;
+        uint64_t round = i / opts.nClients;
+        auto call = round == 0 ? TraceEntry::Call::OPEN
+                               : round == 1 ? TraceEntry::Call::FSTAT
+                                            : TraceEntry::Call::READ;
+
+        uint64_t segmentNo = 0;
+        if (call == TraceEntry::Call::READ) {
+            segmentNo = nextSegment[client];
+            nextSegment[client] = (segmentNo + 1) % nSegments;
+        }
+
+        trace.push_back(getTraceEntry(i * intervalUs, call,
+                                      opts.syntheticFile, segmentNo));
+    }
+    return true;
+}
+
+/**
+ * @brief Get the CPU time in seconds of every thread of this process
+ *
+ */
+static std::map<pid_t, double> getThreadCpuSeconds() {
+    static const double ticks = sysconf(_SC_CLK_TCK);
+    std::map<pid_t, double> threads;
+
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir)
+        return threads;
+
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        std::ifstream file(std::string("/proc/self/task/") + entry->d_name +
+                           "/stat");
+        std::string stat((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+        auto pos = stat.rfind(')');
+        if (pos == std::string::npos)
+            continue;
+
+        // utime and stime are the 12th and 13th fields after the command
+        std::stringstream ss(stat.substr(pos + 2));
+        std::string field;
+        double cpu = 0;
+        for (int i = 0; i < 13 && ss >> field; ++i)
+            if (i >= 11)
+                cpu += std::stod(field) / ticks;
+        threads[std::stoi(entry->d_name)] = cpu;
+    }
+    closedir(dir);
+    return threads;
+}
+
+static double getDiskReadMBytes() {
+    std::ifstream file("/proc/self/io");
+    std::string key;
+    uint64_t value;
+    while (file >> key >> value)
+        if (key == "read_bytes:")
+            return value / 1e6;
+    return -1;
+}
+
+/**
+ * @brief Producer under test, fed either directly through its InterestManager
+ * or through a Producer listening on an in-memory face
+ *
+ */
+class Replayer {
+  public:
+    Replayer(const Options &opts, bool throughFace)
+        : m_face(m_ioService, {false, true}) {
+        auto onData = [this](const ndn::Data &data) { this->onData(data); };
+
+        if (throughFace) {
+            m_dataConnection = m_face.onSendData.connect(onData);
+            m_producer = Producer::getXrdNdnProducerInstance(m_face, opts);
+            m_ioThread = std::thread([this]() {
+                boost::asio::io_service::work work(m_ioService);
+                m_ioService.run();
+            });
+        } else {
+            m_interestManager = std::make_shared<InterestManager>(
+                opts, [onData](std::shared_ptr<ndn::Data> data) {
+                    onData(*data);
+                });
+        }
+    }
+
+    ~Replayer() {
+        m_ioService.stop();
+        if (m_ioThread.joinable())
+            m_ioThread.join();
+        m_producer.reset();
+        m_interestManager.reset();
+    }
+
+    bool isReady() const { return m_producer || m_interestManager; }
+
+    /**
+     * @brief Replay the trace and wait for all Data or the drain timeout
+     *
+     */
+    void replay(const std::vector<TraceEntry> &trace,
+                const ReplayOptions &opts, ReplayResult &result) {
+        auto start = Clock::now();
+
+        for (const auto &entry : trace) {
+            if (opts.speed > 0)
+                std::this_thread::sleep_until(
+                    start + std::chrono::microseconds(static_cast<uint64_t>(
+                                entry.timeUs / opts.speed)));
+
+            {
+                std::unique_lock<std::mutex> lock(m_mtx);
+                m_cv.wait(lock, [&]() {
+                    return m_nOutstanding < opts.maxOutstanding;
+                });
+                ++m_nOutstanding;
+                m_pending[entry.interest.getName()].push_back(Clock::now());
+            }
+            dispatch(entry);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_cv.wait_for(lock, std::chrono::seconds(opts.drainTimeout),
+                      [&]() { return m_nOutstanding == 0; });
+
+        result.wallSeconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+        result.nData = m_nData;
+        result.nBytes = m_nBytes;
+        result.nLost = m_nOutstanding;
+        result.latency.merge(m_latency);
+    }
+
+  private:
+    void dispatch(const TraceEntry &entry) {
+        if (!m_interestManager) {
+            m_ioService.post([this, interest = entry.interest]() {
+                m_face.receive(interest);
+            });
+            return;
+        }
+
+        switch (entry.call) {
+        case TraceEntry::Call::OPEN:
+            m_interestManager->openInterest(entry.interest);
+            break;
+        case TraceEntry::Call::FSTAT:
+            m_interestManager->fstatInterest(entry.interest);
+            break;
+        case TraceEntry::Call::READ:
+            m_interestManager->readInterest(entry.interest);
+            break;
+        case TraceEntry::Call::OPENSTAT:
+            m_interestManager->openStatInterest(entry.interest);
+            break;
+        }
+    }
+
+    void onData(const ndn::Data &data) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mtx);
+
+        auto it = m_pending.find(data.getName());
+        if (it == m_pending.end())
+            return;
+
+        m_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                             now - it->second.front())
+                             .count());
+        it->second.pop_front();
+        if (it->second.empty())
+            m_pending.erase(it);
+
+        ++m_nData;
+        m_nBytes += data.getContent().value_size();
+        --m_nOutstanding;
+        m_cv.notify_one();
+    }
+
+  private:
+    boost::asio::io_service m_ioService;
+    ndn::util::DummyClientFace m_face;
+    ndn::util::signal::ScopedConnection m_dataConnection;
+    std::thread m_ioThread;
+
+    std::shared_ptr<Producer> m_producer;
+    std::shared_ptr<InterestManager> m_interestManager;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::map<ndn::Name, std::deque<Clock::time_point>> m_pending;
+    size_t m_nOutstanding = 0;
+    uint64_t m_nData = 0;
+    uint64_t m_nBytes = 0;
+    xrdndnconsumer::LatencyHistogram m_latency;
+};
+
+static bool runOnce(const std::vector<TraceEntry> &trace,
+                    const ReplayOptions &replayOpts, Options opts,
+                    ReplayResult &result) {
+    opts.gbTimer = std::chrono::seconds(opts.gbTimePeriod);
+    result.nthreads = opts.nthreads;
+    result.signing = !opts.disableSigning;
+
+    auto threadsBefore = getThreadCpuSeconds();
+    Replayer replayer(opts, replayOpts.throughFace);
+    if (!replayer.isReady())
+        return false;
+
+    // Threads created by the Producer are its workers
+    auto workersBefore = getThreadCpuSeconds();
+    for (const auto &thread : threadsBefore)
+        workersBefore.erase(thread.first);
+
+    struct rusage usageBefore, usageAfter;
+    getrusage(RUSAGE_SELF, &usageBefore);
+    double diskBefore = getDiskReadMBytes();
+
+    replayer.replay(trace, replayOpts, result);
+
+    getrusage(RUSAGE_SELF, &usageAfter);
+    auto workersAfter = getThreadCpuSeconds();
+    double diskAfter = getDiskReadMBytes();
+
+    auto toSeconds = [](const struct timeval &tv) {
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    };
+    result.cpuSeconds = toSeconds(usageAfter.ru_utime) -
+                        toSeconds(usageBefore.ru_utime) +
+                        toSeconds(usageAfter.ru_stime) -
+                        toSeconds(usageBefore.ru_stime);
+    result.nVoluntarySwitches = usageAfter.ru_nvcsw - usageBefore.ru_nvcsw;
+    result.nInvoluntarySwitches =
+        usageAfter.ru_nivcsw - usageBefore.ru_nivcsw;
+    if (diskBefore >= 0 && diskAfter >= 0)
+        result.diskMBytes = diskAfter - diskBefore;
+
+    double utilSum = 0;
+    for (const auto &worker : workersBefore) {
+        auto it = workersAfter.find(worker.first);
+        if (it == workersAfter.end())
+            continue;
+        double util = (it->second - worker.second) / result.wallSeconds;
+        utilSum += util;
+        result.workerUtilMax = std::max(result.workerUtilMax, util);
+    }
+    if (!workersBefore.empty())
+        result.workerUtilMean = utilSum / workersBefore.size();
+
+    return true;
+}
+
+/**
+ * @brief A rough guess of what limits the Producer in one run
+ *
+ */
+static std::string getBottleneckHint(const ReplayResult &result) {
+    if (result.nLost > 0)
+        return "unanswered Interests";
+    if (result.workerUtilMax > 0.9)
+        return result.signing ? "cpu (signing?)" : "cpu";
+    if (result.diskMBytes > 0.5 * result.nBytes / 1e6)
+        return "disk i/o";
+    if (result.nData > 0 &&
+        static_cast<double>(result.nVoluntarySwitches) / result.nData > 0.5)
+        return "blocking (locks?)";
+    return "feeder";
+}
+
+static void printHeader() {
+    std::cout << std::left << std::setw(8) << "threads" << std::setw(8)
+              << "signing" << std::right << std::setw(12) << "Data/s"
+              << std::setw(10) << "MB/s" << std::setw(10) << "speedup"
+              << std::setw(10) << "p50_us" << std::setw(10) << "p99_us"
+              << std::setw(10) << "p999_us" << std::setw(10) << "cpu_s"
+              << std::setw(11) << "util_mean" << std::setw(10) << "util_max"
+              << std::setw(10) << "vcsw/req" << std::setw(10) << "disk_MB"
+              << std::setw(8) << "lost"
+              << "  hint" << std::endl;
+}
+
+static void printResult(const ReplayResult &result, double baseRate) {
+    double rate = result.nData / result.wallSeconds;
+
+    std::cout << std::left << std::setw(8) << result.nthreads << std::setw(8)
+              << (result.signing ? "yes" : "no") << std::right << std::fixed
+              << std::setprecision(0) << std::setw(12) << rate
+              << std::setprecision(1) << std::setw(10)
+              << result.nBytes / 1e6 / result.wallSeconds
+              << std::setprecision(2) << std::setw(10)
+              << (baseRate > 0 ? rate / baseRate : 1) << std::setw(10)
+              << result.latency.getPercentile(50) << std::setw(10)
+              << result.latency.getPercentile(99) << std::setw(10)
+              << result.latency.getPercentile(99.9) << std::setw(10)
+              << result.cpuSeconds << std::setw(11) << result.workerUtilMean
+              << std::setw(10) << result.workerUtilMax << std::setw(10)
+              << (result.nData > 0 ? static_cast<double>(
+                                         result.nVoluntarySwitches) /
+                                         result.nData
+                                   : 0)
+              << std::setprecision(1) << std::setw(10)
+              << std::max(result.diskMBytes, 0.0) << std::setw(8)
+              << result.nLost << "  " << getBottleneckHint(result)
+              << std::endl;
+}
+
+static bool parseThreads(const std::string &list,
+                         std::vector<uint16_t> &nthreads) {
+    std::stringstream ss(list);
+    for (std::string field; std::getline(ss, field, ',');) {
+        try {
+            auto n = std::stoul(field);
+            if (n == 0 || n > UINT16_MAX)
+                return false;
+            nthreads.push_back(n);
+        } catch (const std::exception &e) {
+            return false;
+        }
+    }
+    return !nthreads.empty();
+}
+
+static void usage(std::ostream &os, const std::string &programName,
+                  const boost::program_options::options_description &desc) {
+    os << "Usage: " << programName
+       << " [options] (--trace FILE | --synthetic FILE)\n\n"
+       << desc;
+}
+
+int main(int argc, char **argv) {
+    Options opts;
+    ReplayOptions replayOpts;
+    std::string logLevel("NONE");
+
+    boost::program_options::options_description description("Options", 120);
+    description.add_options()(
+        "clients",
+        boost::program_options::value<size_t>(&replayOpts.nClients)
+            ->default_value(replayOpts.nClients),
+        "Number of clients reading the file of a synthetic trace")(
+        "compare-signing",
+        boost::program_options::bool_switch(&replayOpts.compareSigning),
+        "Replay the trace both with and without signing for every number of "
+        "threads")("disable-signing",
+                   boost::program_options::bool_switch(&opts.disableSigning),
+                   "Sign Data with a fake signature")(
+        "drain-timeout",
+        boost::program_options::value<uint64_t>(&replayOpts.drainTimeout)
+            ->default_value(replayOpts.drainTimeout),
+        "Time in seconds to wait for the remaining Data after the last "
+        "Interest was replayed. Unanswered Interests are reported as lost")(
+        "help,h", "Print this help message and exit")(
+        "log-level",
+        boost::program_options::value<std::string>(&logLevel)
+            ->default_value(logLevel),
+        "Producer log level: TRACE, DEBUG, INFO, WARN, ERROR, FATAL, NONE")(
+        "max-outstanding",
+        boost::program_options::value<size_t>(&replayOpts.maxOutstanding)
+            ->default_value(replayOpts.maxOutstanding),
+        "Maximum number of Interests waiting for Data. Replay pauses once "
+        "it is reached")(
+        "nthreads",
+        boost::program_options::value<std::string>(&replayOpts.nthreads)
+            ->default_value(replayOpts.nthreads),
+        "Comma separated numbers of Producer threads to replay the trace "
+        "with")("rate",
+                boost::program_options::value<double>(&replayOpts.rate)
+                    ->default_value(replayOpts.rate),
+                "Interests per second of a synthetic trace. 0 sends them as "
+                "fast as possible")(
+        "requests",
+        boost::program_options::value<uint64_t>(&replayOpts.nRequests)
+            ->default_value(replayOpts.nRequests),
+        "Number of Interests of a synthetic trace")(
+        "speed",
+        boost::program_options::value<double>(&replayOpts.speed)
+            ->default_value(replayOpts.speed),
+        "Replay speed relative to the trace timestamps. 0 ignores the "
+        "timestamps and replays as fast as possible")(
+        "synthetic",
+        boost::program_options::value<std::string>(&replayOpts.syntheticFile),
+        "Synthesize a trace of clients that open, stat and sequentially read "
+        "this file")("through-face",
+                     boost::program_options::bool_switch(
+                         &replayOpts.throughFace),
+                     "Send Interests to a Producer on an in-memory face "
+                     "instead of calling the Interest Manager directly")(
+        "trace",
+        boost::program_options::value<std::string>(&replayOpts.traceFile),
+        "Trace file with time_us,call,path[,segment] lines");
+
+    boost::program_options::variables_map vm;
+    try {
+        boost::program_options::store(
+            boost::program_options::command_line_parser(argc, argv)
+                .options(description)
+                .run(),
+            vm);
+        boost::program_options::notify(vm);
+    } catch (const boost::program_options::error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::string programName = argv[0];
+
+    if (vm.count("help") > 0) {
+        usage(std::cout, programName, description);
+        return 0;
+    }
+
+    if (replayOpts.traceFile.empty() == replayOpts.syntheticFile.empty()) {
+        std::cerr << "ERROR: Exactly one of --trace and --synthetic is "
+                     "required"
+                  << std::endl;
+        usage(std::cerr, programName, description);
+        return 2;
+    }
+
+    std::vector<uint16_t> nthreads;
+    if (!parseThreads(replayOpts.nthreads, nthreads) ||
+        replayOpts.nClients == 0 || replayOpts.maxOutstanding == 0) {
+        std::cerr << "ERROR: Thread counts, clients and outstanding "
+                     "Interests must be positive numbers"
+                  << std::endl;
+        return 2;
+    }
+
+    try {
+        ndn::util::Logging::setLevel(PRODUCER_LOGGER_PREFIX "=" + logLevel);
+    } catch (const std::invalid_argument &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::vector<TraceEntry> trace;
+    if (!(replayOpts.traceFile.empty()
+              ? getSyntheticTrace(replayOpts, trace)
+              : readTrace(replayOpts.traceFile, trace)))
+        return 2;
+
+    std::cout << "Replaying " << trace.size() << " Interests "
+              << (replayOpts.throughFace ? "through an in-memory face"
+                                         : "into the Interest Manager")
+              << std::endl;
+    printHeader();
+
+    std::vector<bool> signing = {!opts.disableSigning};
+    if (replayOpts.compareSigning)
+        signing = {true, false};
+
+    std::map<bool, double> baseRates;
+    for (auto n : nthreads) {
+        for (auto sign : signing) {
+            opts.nthreads = n;
+            opts.disableSigning = !sign;
+
+            ReplayResult result;
+            if (!runOnce(trace, replayOpts, opts, result)) {
+                std::cerr << "ERROR: Unable to start the Producer"
+                          << std::endl;
+                return 2;
+            }
+
+            if (baseRates.count(sign) == 0)
+                baseRates[sign] = result.nData / result.wallSeconds;
+            printResult(result, baseRates[sign]);
+        }
+    }
+
+    return 0;
+}
+} // namespace xrdndnproducer
+
+int main(int argc, char **argv) { return xrdndnproducer::main(argc, argv); }
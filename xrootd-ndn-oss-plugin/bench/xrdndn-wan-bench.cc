@@ -0,0 +1,258 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/xrdndn-consumer/xrdndn-consumer.hh"
+#include "xrdndn-loopback.hh"
+
+/**
+ * @brief Transfer of a file between Consumer and Producer in one process over
+ * an emulated wide area link. Each link preset, either given on the command
+ * line or read from a presets file generated out of the cms_topology
+ * measurements, is benchmarked for a sweep of pipeline sizes and the
+ * throughput, Pipeline retransmissions, NACKs, timeouts, hedged Interests,
+ * segment latency and link drops are reported.
+ *
+ * Usage: xrdndn-wan-bench [--presets=FILE] [--rtt-ms=N] [--bandwidth-mbps=N]
+ *        [--loss=P] [--reorder=P] [--queue-ms=N] [--file-size=BYTES]
+ *        [--interest-lifetime=SEC] [--hedge-percentile=P]
+ *        [google-benchmark flags]
+ *
+ * The presets file has one link per line: name,rtt_ms,bandwidth_mbps,loss,
+ * reorder. Lines starting with '#' are ignored
+ *
+ */
+
+static const std::vector<int64_t> PIPELINE_SIZES = {16, 64, 256, 512};
+
+struct WanBenchOptions {
+    std::string presetsFile;
+    WanLinkParams link;
+    uint64_t fileSize = 16 << 20;
+    size_t interestLifetime = XRDNDN_MININTEREST_LIFETIME;
+    double hedgePercentile = 0;
+};
+
+/**
+ * @brief Read link presets from a CSV file
+ *
+ * @return std::vector<WanLinkParams> The presets. Empty if the file can not be
+ * read or has no valid line
+ */
+static std::vector<WanLinkParams> readPresets(const std::string &path) {
+    std::vector<WanLinkParams> presets;
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Unable to open presets file: " << path << std::endl;
+        return presets;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::stringstream ss(line);
+        std::vector<std::string> fields;
+        for (std::string field; std::getline(ss, field, ',');)
+            fields.push_back(field);
+
+        try {
+            if (fields.size() != 5)
+                throw std::invalid_argument("expected 5 fields");
+
+            WanLinkParams params;
+            params.name = fields[0];
+            params.rttMs = std::stod(fields[1]);
+            params.bandwidthMbps = std::stod(fields[2]);
+            params.loss = std::stod(fields[3]);
+            params.reorder = std::stod(fields[4]);
+            presets.push_back(params);
+        } catch (const std::exception &e) {
+            std::cerr << "Skipping invalid preset: " << line << std::endl;
+        }
+    }
+    return presets;
+}
+
+/**
+ * @brief Consume the benchmark specific flags and leave the others for
+ * google-benchmark
+ *
+ */
+static bool parseOptions(int &argc, char **argv, WanBenchOptions &opts) {
+    int nargs = 1;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *sep = std::strchr(arg, '=');
+        std::string key = sep ? std::string(arg, sep - arg) : arg;
+        std::string value = sep ? sep + 1 : "";
+
+        try {
+            if (key == "--presets")
+                opts.presetsFile = value;
+            else if (key == "--rtt-ms")
+                opts.link.rttMs = std::stod(value);
+            else if (key == "--bandwidth-mbps")
+                opts.link.bandwidthMbps = std::stod(value);
+            else if (key == "--loss")
+                opts.link.loss = std::stod(value);
+            else if (key == "--reorder")
+                opts.link.reorder = std::stod(value);
+            else if (key == "--queue-ms")
+                opts.link.queueMs = std::stod(value);
+            else if (key == "--file-size")
+                opts.fileSize = std::stoull(value);
+            else if (key == "--interest-lifetime")
+                opts.interestLifetime = std::stoul(value);
+            else if (key == "--hedge-percentile")
+                opts.hedgePercentile = std::stod(value);
+            else {
+                argv[nargs++] = argv[i];
+                continue;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Invalid value for " << key << std::endl;
+            return false;
+        }
+    }
+    argc = nargs;
+
+    if (opts.link.loss < 0 || opts.link.loss > 1 || opts.link.reorder < 0 ||
+        opts.link.reorder > 1) {
+        std::cerr << "Loss and reorder must be between 0 and 1" << std::endl;
+        return false;
+    }
+    if (opts.interestLifetime < XRDNDN_MININTEREST_LIFETIME ||
+        opts.interestLifetime > XRDNDN_MAXINTEREST_LIFETIME) {
+        std::cerr << "Interest lifetime must be between "
+                  << XRDNDN_MININTEREST_LIFETIME << " and "
+                  << XRDNDN_MAXINTEREST_LIFETIME << " seconds" << std::endl;
+        return false;
+    }
+    return opts.fileSize > 0;
+}
+
+static void BM_Wan(benchmark::State &state, const WanLinkParams &link,
+                   const WanBenchOptions &opts) {
+    const std::string path = getBenchFile(opts.fileSize);
+
+    xrdndnconsumer::Options consumerOpts;
+    consumerOpts.pipelineSize = state.range(0);
+    consumerOpts.interestLifetime = opts.interestLifetime;
+    consumerOpts.hedgePercentile = opts.hedgePercentile;
+    consumerOpts.logLevel = "NONE";
+
+    xrdndnproducer::Options producerOpts;
+    producerOpts.disableSigning = true;
+    producerOpts.gbTimer = std::chrono::seconds(producerOpts.gbTimePeriod);
+
+    Loopback loopback(consumerOpts, producerOpts, &link);
+    if (!loopback.getSession()) {
+        state.SkipWithError("Unable to connect Consumer and Producer");
+        return;
+    }
+
+    std::vector<char> buff(READ_SIZE);
+    uint64_t nBytes = 0;
+
+    for (auto _ : state) {
+        auto consumer = xrdndnconsumer::Consumer::getXrdNdnConsumerInstance(
+            consumerOpts, loopback.getSession());
+        if (!consumer || consumer->Open(path) != XRDNDN_ESUCCESS) {
+            state.SkipWithError("Unable to open file over WAN link");
+            break;
+        }
+
+        for (uint64_t offset = 0; offset < opts.fileSize;
+             offset += READ_SIZE) {
+            auto retRead = consumer->Read(
+                buff.data(), offset,
+                std::min<uint64_t>(READ_SIZE, opts.fileSize - offset));
+            if (retRead <= 0) {
+                state.SkipWithError("Read failed over WAN link");
+                break;
+            }
+            nBytes += retRead;
+        }
+
+        consumer->Close();
+    }
+
+    auto stats = loopback.getSession()->getPipeline().getStatisticsSnapshot();
+    auto &linkStats = loopback.getWanLink()->getStatistics();
+
+    state.SetBytesProcessed(nBytes);
+    state.counters["Mbps"] = benchmark::Counter(
+        nBytes * 8 / 1e6, benchmark::Counter::kIsRate);
+    state.counters["retx"] = stats.nRetransmissions;
+    state.counters["nacks"] = stats.nNacks;
+    state.counters["timeouts"] = stats.nTimeouts;
+    state.counters["failures"] = stats.nFailures;
+    state.counters["hedges"] = stats.nHedges;
+    state.counters["hedges_won"] = stats.nHedgesWon;
+    state.counters["p50_ms"] = stats.latency.getPercentile(50) / 1e3;
+    state.counters["p99_ms"] = stats.latency.getPercentile(99) / 1e3;
+    state.counters["lost"] = linkStats.nLost;
+    state.counters["queue_drops"] = linkStats.nQueueDropped;
+    state.counters["reordered"] = linkStats.nReordered;
+}
+
+int main(int argc, char **argv) {
+    WanBenchOptions opts;
+    if (!parseOptions(argc, argv, opts))
+        return 1;
+
+    std::vector<WanLinkParams> presets;
+    if (!opts.presetsFile.empty()) {
+        presets = readPresets(opts.presetsFile);
+        if (presets.empty())
+            return 1;
+        for (auto &preset : presets)
+            preset.queueMs = opts.link.queueMs;
+    } else {
+        presets.push_back(opts.link);
+    }
+
+    for (const auto &preset : presets) {
+        benchmark::RegisterBenchmark(("BM_Wan/" + preset.name).c_str(),
+                                     BM_Wan, preset, opts)
+            ->ArgName("pipeline")
+            ->ArgsProduct({PIPELINE_SIZES})
+            ->Iterations(1)
+            ->UseRealTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,189 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_WAN_LINK_HH
+#define XRDNDN_WAN_LINK_HH
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <boost/asio/steady_timer.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/signal.hpp>
+
+/**
+ * @brief Characteristics of an emulated wide area link
+ *
+ */
+struct WanLinkParams {
+    // Preset name, e.g. the source and destination sites
+    std::string name = "custom";
+    // Round trip propagation delay
+    double rttMs = 0;
+    // Bottleneck bandwidth in each direction. 0 means unlimited
+    double bandwidthMbps = 0;
+    // Probability of dropping a packet, between 0 and 1
+    double loss = 0;
+    // Probability of delaying a packet past the ones sent after it
+    double reorder = 0;
+    // Packets that would wait longer than this in the bottleneck queue are
+    // dropped, which is where congestion losses come from
+    double queueMs = 100;
+};
+
+/**
+ * @brief Emulated wide area link between two DummyClientFace instances. Every
+ * packet sent by one face is delivered to the other one after the
+ * serialization delay of a FIFO bottleneck queue and half the RTT, or it is
+ * dropped at random or when the queue is full. Both faces must share the
+ * io_service that is passed here and all packets are handled on its thread,
+ * thus no locking is needed
+ *
+ */
+class WanLink {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief One direction of the link
+     *
+     */
+    struct Direction {
+        Direction(ndn::util::DummyClientFace &to) : to(to) {}
+
+        ndn::util::DummyClientFace &to;
+        Clock::time_point busyUntil;
+    };
+
+  public:
+    /**
+     * @brief Counters of packets handled by the link in both directions
+     *
+     */
+    struct Statistics {
+        uint64_t nDelivered = 0;
+        uint64_t nLost = 0;
+        uint64_t nQueueDropped = 0;
+        uint64_t nReordered = 0;
+    };
+
+    /**
+     * @brief Construct a new Wan Link object
+     *
+     * @param ioService The io_service of both faces
+     * @param consumerFace Face of the Consumer
+     * @param producerFace Face of the Producer
+     * @param params Link characteristics
+     * @param seed Seed of loss and reordering decisions, so that runs with
+     * the same parameters see the same packet fate sequence
+     */
+    WanLink(boost::asio::io_service &ioService,
+            ndn::util::DummyClientFace &consumerFace,
+            ndn::util::DummyClientFace &producerFace,
+            const WanLinkParams &params, uint64_t seed = 1)
+        : m_ioService(ioService), m_params(params),
+          m_toProducer(producerFace), m_toConsumer(consumerFace),
+          m_random(seed) {
+        m_interestConnection =
+            consumerFace.onSendInterest.connect([this](const auto &interest) {
+                send(m_toProducer, interest,
+                     interest.wireEncode().size());
+            });
+        m_dataConnection =
+            producerFace.onSendData.connect([this](const auto &data) {
+                send(m_toConsumer, data, data.wireEncode().size());
+            });
+        m_nackConnection =
+            producerFace.onSendNack.connect([this](const auto &nack) {
+                send(m_toConsumer, nack,
+                     nack.getInterest().wireEncode().size());
+            });
+    }
+
+    const Statistics &getStatistics() const { return m_statistics; }
+
+  private:
+    template <typename Packet>
+    void send(Direction &direction, const Packet &packet, size_t size) {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        if (uniform(m_random) < m_params.loss) {
+            ++m_statistics.nLost;
+            return;
+        }
+
+        auto now = Clock::now();
+        auto start = std::max(now, direction.busyUntil);
+        if (start - now > toDuration(m_params.queueMs)) {
+            ++m_statistics.nQueueDropped;
+            return;
+        }
+
+        // Serialization delay at the bottleneck: bits / (Mbit/s) = us
+        if (m_params.bandwidthMbps > 0)
+            direction.busyUntil =
+                start + std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double, std::micro>(
+                                size * 8 / m_params.bandwidthMbps));
+        else
+            direction.busyUntil = start;
+
+        auto arrival = direction.busyUntil + toDuration(m_params.rttMs / 2);
+        if (uniform(m_random) < m_params.reorder) {
+            // Hold the packet back by up to half the RTT so that later ones
+            // overtake it, as with per-packet load balancing across paths
+            arrival += toDuration(uniform(m_random) *
+                                  std::max(m_params.rttMs / 2, 1.0));
+            ++m_statistics.nReordered;
+        }
+
+        auto timer = std::make_shared<boost::asio::steady_timer>(m_ioService);
+        timer->expires_at(arrival);
+        timer->async_wait([this, timer, &direction,
+                           packet](const boost::system::error_code &ec) {
+            if (ec)
+                return;
+            ++m_statistics.nDelivered;
+            direction.to.receive(packet);
+        });
+    }
+
+    static Clock::duration toDuration(double ms) {
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(ms));
+    }
+
+  private:
+    boost::asio::io_service &m_ioService;
+    const WanLinkParams m_params;
+
+    Direction m_toProducer;
+    Direction m_toConsumer;
+
+    std::mt19937_64 m_random;
+    Statistics m_statistics;
+
+    ndn::util::signal::ScopedConnection m_interestConnection;
+    ndn::util::signal::ScopedConnection m_dataConnection;
+    ndn::util::signal::ScopedConnection m_nackConnection;
+};
+
+#endif // XRDNDN_WAN_LINK_HH
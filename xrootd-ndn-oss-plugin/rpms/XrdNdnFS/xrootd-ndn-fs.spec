@@ -28,7 +28,7 @@ git clone %{url}
 cd %{SrcDir}
 mkdir build
 cd build
-cmake ../
+cmake -DCMAKE_BUILD_TYPE=Release ../
 make XrdNdnFS VERBOSE=1
 
 %install
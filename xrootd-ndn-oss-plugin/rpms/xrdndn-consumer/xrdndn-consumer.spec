@@ -27,7 +27,7 @@ git clone %{url}
 cd %{SrcDir}
 mkdir build
 cd build
-cmake ../
+cmake -DCMAKE_BUILD_TYPE=Release ../
 make xrdndn-consumer VERBOSE=1
 
 %install
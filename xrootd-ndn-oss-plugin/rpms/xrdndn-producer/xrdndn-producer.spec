@@ -29,7 +29,7 @@ git clone %{url}
 cd %{SrcDir}
 mkdir build
 cd build
-cmake ../
+cmake -DCMAKE_BUILD_TYPE=Release ../
 make xrdndn-producer VERBOSE=1
 
 %install
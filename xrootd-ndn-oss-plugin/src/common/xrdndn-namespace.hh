@@ -42,6 +42,36 @@ namespace xrdndn {
  */
 #define XRDNDN_MAX_NDN_PACKET_SIZE 7168
 
+/**
+ * @brief TLV type of the struct stat element carried in the content of a
+ * combined open Data packet
+ *
+ */
+#define XRDNDN_TLV_STAT 128
+
+/**
+ * @brief TLV type of the leading file segment element carried in the content
+ * of a combined open Data packet
+ *
+ */
+#define XRDNDN_TLV_SEGMENT 129
+
+/**
+ * @brief TLV type of the file handle element carried in the content of a
+ * combined open Data packet. Its value is the encoded Name that replaces the
+ * file path in read Interest Names
+ *
+ */
+#define XRDNDN_TLV_FILE_HANDLE 130
+
+/**
+ * @brief TLV type of the file version element carried in the content of a
+ * combined open Data packet. Read Interest Names carrying the version get
+ * immutable Data
+ *
+ */
+#define XRDNDN_TLV_FILE_VERSION 131
+
 /**
  * @brief Name prefix for all Interest packets expressed by Consumer
  *
@@ -68,6 +98,12 @@ static const ndn::Name SYS_CALL_FSTAT_PREFIX_URI("/ndn/xrootd/fstat/");
  *
  */
 static const ndn::Name SYS_CALL_READ_PREFIX_URI("/ndn/xrootd/read/");
+/**
+ * @brief Name filter for the combined open, fstat and first segment read
+ * Interest packet
+ *
+ */
+static const ndn::Name SYS_CALL_OPEN_STAT_PREFIX_URI("/ndn/xrootd/openstat/");
 } // namespace xrdndn
 
 #endif // XRDNDN_NAMESPACE_HH
\ No newline at end of file
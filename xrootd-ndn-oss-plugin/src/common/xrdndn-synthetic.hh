@@ -0,0 +1,150 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_SYNTHETIC_HH
+#define XRDNDN_SYNTHETIC_HH
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <endian.h>
+
+namespace xrdndn {
+/**
+ * @brief Path prefix of the virtual files served by a Producer started with
+ * synthetic files enabled. The full path is /synthetic/<size>/<seed>, where
+ * size is in bytes, optionally followed by K, M, G or T (powers of 1024)
+ *
+ */
+static const std::string SYNTHETIC_PATH_PREFIX("/synthetic/");
+
+/**
+ * @brief Content of virtual files, generated from the seed and the offset only
+ * so that any byte range can be produced or checked independently without
+ * touching storage. Every 8-byte word of the file is the SplitMix64 output for
+ * its index, stored little endian
+ *
+ */
+class Synthetic {
+  public:
+    /**
+     * @brief Parse a synthetic file path
+     *
+     * @param path The file path
+     * @param size Set to the file size in bytes
+     * @param seed Set to the content seed
+     * @return bool True if path is a valid synthetic file path
+     */
+    static bool parsePath(const std::string &path, uint64_t &size,
+                          uint64_t &seed) noexcept {
+        if (path.compare(0, SYNTHETIC_PATH_PREFIX.size(),
+                         SYNTHETIC_PATH_PREFIX) != 0)
+            return false;
+
+        const char *str = path.c_str() + SYNTHETIC_PATH_PREFIX.size();
+        char *end;
+        if (!isdigit(*str))
+            return false;
+        size = strtoull(str, &end, 10);
+
+        static const std::string units("KMGT");
+        auto unit = *end ? units.find(*end) : std::string::npos;
+        if (unit != std::string::npos) {
+            size <<= 10 * (unit + 1);
+            ++end;
+        }
+
+        if (*end != '/' || !isdigit(*(end + 1)))
+            return false;
+        seed = strtoull(end + 1, &end, 10);
+        return *end == '\0';
+    }
+
+    /**
+     * @brief Fill a buffer with the content of a synthetic file
+     *
+     * @param buff The buffer
+     * @param count Number of bytes to fill
+     * @param offset Offset of the first byte in the file
+     * @param seed The content seed
+     */
+    static void fill(uint8_t *buff, size_t count, uint64_t offset,
+                     uint64_t seed) noexcept {
+        while (count > 0) {
+            uint64_t word = getWord(offset / 8, seed);
+            size_t skip = offset % 8;
+            size_t len = std::min<size_t>(8 - skip, count);
+
+            memcpy(buff, reinterpret_cast<uint8_t *>(&word) + skip, len);
+            buff += len;
+            count -= len;
+            offset += len;
+        }
+    }
+
+    /**
+     * @brief Check that a buffer holds the content of a synthetic file
+     *
+     * @param buff The buffer
+     * @param count Number of bytes to check
+     * @param offset Offset of the first byte in the file
+     * @param seed The content seed
+     * @param mismatch Set to the file offset of the first wrong byte
+     * @return bool True if all bytes match
+     */
+    static bool verify(const uint8_t *buff, size_t count, uint64_t offset,
+                       uint64_t seed, uint64_t &mismatch) noexcept {
+        uint8_t expected[4096];
+        while (count > 0) {
+            size_t len = std::min(count, sizeof(expected));
+            fill(expected, len, offset, seed);
+
+            if (memcmp(buff, expected, len) != 0) {
+                for (size_t i = 0; i < len; ++i) {
+                    if (buff[i] != expected[i]) {
+                        mismatch = offset + i;
+                        return false;
+                    }
+                }
+            }
+
+            buff += len;
+            count -= len;
+            offset += len;
+        }
+        return true;
+    }
+
+  private:
+    static uint64_t getWord(uint64_t index, uint64_t seed) noexcept {
+        uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+        return htole64(z);
+    }
+};
+} // namespace xrdndn
+
+#endif // XRDNDN_SYNTHETIC_HH
@@ -38,11 +38,155 @@ class Utils {
      * @param segmentNo The segment number
      * @return ndn::Name The resulting NDN Name
      */
-    static ndn::Name getName(ndn::Name prefix, std::string path,
+    static ndn::Name getName(const ndn::Name &prefix, const std::string &path,
                              uint64_t segmentNo = 0) noexcept {
+        auto name = getFilePrefix(prefix, path);
         return prefix == SYS_CALL_READ_PREFIX_URI
-                   ? prefix.append(path).appendSegment(segmentNo)
-                   : prefix.append(path);
+                   ? name.appendSegment(segmentNo)
+                   : name;
+    }
+
+    /**
+     * @brief Get the Name of a file under a system call prefix, without
+     * segment number. Computed once per file, so that the Name of each segment
+     * only needs the segment number appended instead of parsing the path again
+     *
+     * @param prefix The prefix of the Name
+     * @param path The file path
+     * @return ndn::Name The resulting NDN Name
+     */
+    static ndn::Name getFilePrefix(const ndn::Name &prefix,
+                                   const std::string &path) noexcept {
+        ndn::Name name(prefix);
+        return name.append(path);
+    }
+
+    /**
+     * @brief Get the range of components of an Interest Name that identify the
+     * file: all components after the system call prefix except a trailing
+     * segment number and file version
+     *
+     * @param name The Name
+     * @param begin Set to the index of the first file component
+     * @param end Set to the index after the last file component
+     * @return bool False if the Name has no file components
+     */
+    static bool getFileComponents(const ndn::Name &name, size_t &begin,
+                                  size_t &end) noexcept {
+        begin = xrdndn::SYS_CALLS_PREFIX_LEN;
+        end = name.size();
+        if (end > begin && name.get(end - 1).isSegment())
+            --end;
+        if (end > begin && name.get(end - 1).isVersion())
+            --end;
+        return end > begin;
+    }
+
+    /**
+     * @brief Get the file version from a read Interest Name named by file
+     * path: /<prefix>/<path>/<version>/<segment>
+     *
+     * @param name The Name
+     * @param version Set to the file version
+     * @return bool False if the Name carries no file version
+     */
+    static bool getFileVersion(const ndn::Name &name,
+                               uint64_t &version) noexcept {
+        if (name.size() < xrdndn::SYS_CALLS_PREFIX_LEN + 3u ||
+            !name.get(-1).isSegment() || !name.get(-2).isVersion())
+            return false;
+
+        version = name.get(-2).toVersion();
+        return true;
+    }
+
+    /**
+     * @brief Hash the file components of an Interest Name in place, without
+     * building the file path. Names of all system calls and segments of one
+     * file have the same hash
+     *
+     * @param name The Name
+     * @return size_t The hash. 0 if the Name has no file components
+     */
+    static size_t getFileHash(const ndn::Name &name) noexcept {
+        size_t begin, end;
+        if (!getFileComponents(name, begin, end))
+            return 0;
+
+        // FNV-1a over the TLV wire of each component, so that the boundaries
+        // between components are part of the hash
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = begin; i < end; ++i) {
+            const auto &component = name.get(i);
+            for (size_t j = 0; j < component.size(); ++j) {
+                hash ^= component.wire()[j];
+                hash *= 1099511628211ULL;
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Check whether two Names refer to the same file, comparing their
+     * file components
+     *
+     * @param lhs A Name
+     * @param rhs Another Name
+     * @return bool True if both Names have the same file components
+     */
+    static bool isSameFile(const ndn::Name &lhs,
+                           const ndn::Name &rhs) noexcept {
+        size_t lhsBegin, lhsEnd, rhsBegin, rhsEnd;
+        if (!getFileComponents(lhs, lhsBegin, lhsEnd) ||
+            !getFileComponents(rhs, rhsBegin, rhsEnd) ||
+            lhsEnd - lhsBegin != rhsEnd - rhsBegin)
+            return false;
+
+        for (size_t i = 0; i < lhsEnd - lhsBegin; ++i) {
+            if (lhs.get(lhsBegin + i) != rhs.get(rhsBegin + i))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Get the Name of a file handle: the Producer instance version
+     * followed by the handle number. Read Interest Names carry it instead of
+     * the file path
+     *
+     * @param id The handle number
+     * @param version The version of the Producer instance that assigned it
+     * @return ndn::Name The handle Name
+     */
+    static ndn::Name getFileHandleName(uint64_t id,
+                                       uint64_t version) noexcept {
+        return ndn::Name().appendVersion(version).appendNumber(id);
+    }
+
+    /**
+     * @brief Get the file handle from a read Interest Name. A Name carries a
+     * handle if it has a version component right after the system call
+     * prefix, which a file path, being text, never starts with
+     *
+     * @param name The Name
+     * @param id Set to the handle number
+     * @param version Set to the version of the Producer instance
+     * @return bool False if the Name carries a file path
+     */
+    static bool getFileHandle(const ndn::Name &name, uint64_t &id,
+                              uint64_t &version) noexcept {
+        if (name.size() != xrdndn::SYS_CALLS_PREFIX_LEN + 3u)
+            return false;
+
+        const auto &versionComponent = name.get(xrdndn::SYS_CALLS_PREFIX_LEN);
+        const auto &idComponent = name.get(xrdndn::SYS_CALLS_PREFIX_LEN + 1);
+        if (!versionComponent.isVersion() || !idComponent.isNumber() ||
+            !name.get(-1).isSegment())
+            return false;
+
+        version = versionComponent.toVersion();
+        id = idComponent.toNumber();
+        return true;
     }
 
     /**
@@ -52,17 +196,13 @@ class Utils {
      * @return std::string The file name as a std::string
      */
     static std::string getPath(const ndn::Name &name) noexcept {
-        try {
-            if (name.at(-1).isSegment())
-                return name.getSubName(xrdndn::SYS_CALLS_PREFIX_LEN)
-                    .getPrefix(-1)
-                    .toUri();
-        } catch (ndn::Name::Error &error) {
+        size_t begin, end;
+        if (!getFileComponents(name, begin, end)) {
             std::cerr << "Unable to get file path from Name: " << name
                       << std::endl;
             return std::string();
         }
-        return name.getSubName(xrdndn::SYS_CALLS_PREFIX_LEN).toUri();
+        return name.getSubName(begin, end - begin).toUri();
     }
 
     /**
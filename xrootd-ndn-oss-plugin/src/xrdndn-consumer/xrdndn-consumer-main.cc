@@ -18,9 +18,17 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
  *****************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
 
 #include <ndn-cxx/version.hpp>
 
@@ -31,6 +39,7 @@
 #include <boost/version.hpp>
 
 #include "../common/xrdndn-logger.hh"
+#include "../common/xrdndn-synthetic.hh"
 #include "xrdndn-consumer-options.hh"
 #include "xrdndn-consumer-version.hh"
 #include "xrdndn-consumer.hh"
@@ -41,38 +50,225 @@ struct CommandLineOptions {
     std::string infile;
     std::string outfile;
 
+    std::string inputList;
+    std::string localInputDir;
+    std::string outputDir;
+
     uint64_t bsize = 262144;
     uint16_t nthreads = 1;
+    uint16_t filesInFlight = 4;
+
+    bool benchmark = false;
+    uint64_t benchmarkDuration = 0; // sec
+    uint64_t benchmarkBytes = 0;
+    uint64_t reportInterval = 1000; // ms
+    std::string jsonFile;
+
+    bool verifySynthetic = false;
 };
 
-class SynchronizedWrite {
+/**
+ * @brief Output file written in place by all reader threads. Every chunk goes
+ * straight to its offset with pwrite, thus threads need no lock and nothing
+ * is buffered beyond each thread's chunk buffer
+ *
+ */
+class OutputFile {
   public:
-    SynchronizedWrite(std::string path)
-        : ostream(path, std::ofstream::binary) {}
-    ~SynchronizedWrite() { ostream.close(); }
+    OutputFile(const std::string &path) : m_path(path) {
+        m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd == XRDNDN_EFAILURE)
+            NDN_LOG_ERROR("Unable to open output file: " << m_path << ". "
+                                                         << strerror(errno));
+    }
+
+    ~OutputFile() {
+        if (m_fd != XRDNDN_EFAILURE)
+            close(m_fd);
+    }
+
+    bool isOpened() const { return m_fd != XRDNDN_EFAILURE; }
+
+    /**
+     * @brief Reserve the final size of the file, so that blocks written out of
+     * order by different threads do not grow it piecemeal
+     *
+     */
+    bool allocate(off_t size) {
+        if (size == 0)
+            return true;
+
+        int ret = posix_fallocate(m_fd, 0, size);
+        if (ret == EOPNOTSUPP || ret == EINVAL)
+            ret = ftruncate(m_fd, size) == XRDNDN_EFAILURE ? errno : 0;
+
+        if (ret != 0) {
+            NDN_LOG_ERROR("Unable to allocate " << size
+                                                << " bytes for output file: "
+                                                << m_path << ". "
+                                                << strerror(ret));
+            return false;
+        }
+        return true;
+    }
 
-    void write(off_t offset, const char *buf, off_t len) {
-        boost::lock_guard<boost::mutex> lock(mutex_);
-        ostream.seekp(offset);
-        ostream.write(buf, len);
+    bool write(off_t offset, const char *buf, size_t len) {
+        while (len > 0) {
+            auto ret = pwrite(m_fd, buf, len, offset);
+            if (ret == XRDNDN_EFAILURE) {
+                if (errno == EINTR)
+                    continue;
+
+                NDN_LOG_ERROR("Unable to write " << len << " bytes @" << offset
+                                                 << " to output file: "
+                                                 << m_path << ". "
+                                                 << strerror(errno));
+                return false;
+            }
+
+            buf += ret;
+            len -= ret;
+            offset += ret;
+        }
+        return true;
     }
 
   private:
-    std::ofstream ostream;
-    boost::mutex mutex_;
+    const std::string m_path;
+    int m_fd;
 };
 
 struct CommandLineOptions cmdLineOpts;
 struct Options consumerOpts;
 
-std::shared_ptr<SynchronizedWrite> syncWrite;
-std::shared_ptr<Consumer> consumer;
+/**
+ * @brief State of one file copy, shared by its reader threads
+ *
+ */
+struct Transfer {
+    std::shared_ptr<Consumer> consumer;
+    std::shared_ptr<OutputFile> outputFile;
+    std::atomic<bool> failed{false};
+    std::atomic<uint64_t> nBytes{0};
+
+    // Check every block read against the generated content of a synthetic
+    // file with this seed
+    bool verify = false;
+    uint64_t syntheticSeed = 0;
+};
+
+/**
+ * @brief Prepare the verification of a synthetic file transfer, if requested
+ *
+ * @return bool False if verification was requested but the path is not a
+ * synthetic file path or the size reported by the Producer is wrong
+ */
+bool setVerification(Transfer &transfer, const std::string &infile,
+                     off_t fileSize) {
+    if (!cmdLineOpts.verifySynthetic)
+        return true;
+
+    uint64_t size;
+    if (!xrdndn::Synthetic::parsePath(infile, size,
+                                      transfer.syntheticSeed)) {
+        NDN_LOG_ERROR("Unable to verify file: "
+                      << infile << ". Not a synthetic file path: "
+                      << xrdndn::SYNTHETIC_PATH_PREFIX << "<size>/<seed>");
+        return false;
+    }
+
+    if (static_cast<uint64_t>(fileSize) != size) {
+        NDN_LOG_ERROR("Synthetic file: " << infile << " has size " << fileSize
+                                         << " instead of " << size);
+        return false;
+    }
+
+    transfer.verify = true;
+    return true;
+}
+
+bool verifyBlock(Transfer &transfer, const char *buff, size_t len,
+                 off_t offset, int threadID) {
+    uint64_t mismatch;
+    if (!transfer.verify ||
+        xrdndn::Synthetic::verify(reinterpret_cast<const uint8_t *>(buff),
+                                  len, offset, transfer.syntheticSeed,
+                                  mismatch))
+        return true;
+
+    NDN_LOG_ERROR("[Thread " << threadID << "] Content mismatch at offset "
+                             << mismatch << " in block " << len << "@"
+                             << offset);
+    return false;
+}
+
+/**
+ * @brief Size of the Read calls and of the buffer of each reader thread: one
+ * Pipeline window of segments at most. A block of --bsize bytes is read chunk
+ * by chunk, so memory does not grow with the block size
+ *
+ */
+size_t getChunkSize() {
+    uint64_t windowSize =
+        consumerOpts.pipelineSize * XRDNDN_MAX_NDN_PACKET_SIZE;
+    return std::min<uint64_t>(cmdLineOpts.bsize, windowSize);
+}
+
+/**
+ * @brief Get the peak resident set size of the process in MB
+ *
+ */
+double getPeakRss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == XRDNDN_EFAILURE)
+        return 0;
+    // Kilobytes on Linux
+    return usage.ru_maxrss / 1024.0;
+}
+
+/**
+ * @brief Read a block chunk by chunk, checking and writing every chunk to the
+ * output file as soon as it is read
+ *
+ * @return ssize_t The number of bytes read, or -1 on failure
+ */
+ssize_t readBlock(Transfer &transfer, std::vector<char> &buff, off_t offset,
+                  off_t blen, int threadID) {
+    ssize_t nBytes = 0;
+    while (nBytes < blen) {
+        off_t chunkOffset = offset + nBytes;
+        off_t chunkLen = std::min<off_t>(buff.size(), blen - nBytes);
+
+        auto retRead =
+            transfer.consumer->Read(buff.data(), chunkOffset, chunkLen);
+        if (retRead < 0) {
+            NDN_LOG_ERROR("[Thread " << threadID << "] Unable to read "
+                                     << chunkLen << "@" << chunkOffset << ". "
+                                     << strerror(abs(retRead)));
+            return XRDNDN_EFAILURE;
+        }
+        transfer.nBytes += retRead;
+
+        if (!verifyBlock(transfer, buff.data(), retRead, chunkOffset,
+                         threadID))
+            return XRDNDN_EFAILURE;
 
-void read(off_t fileSize, off_t off, int threadID) {
-    std::string buff(cmdLineOpts.bsize, '\0');
+        if (transfer.outputFile &&
+            !transfer.outputFile->write(chunkOffset, buff.data(), retRead))
+            return XRDNDN_EFAILURE;
+
+        nBytes += retRead;
+        // End of file
+        if (retRead < chunkLen)
+            break;
+    }
+    return nBytes;
+}
+
+void read(Transfer &transfer, off_t fileSize, off_t off, int threadID) {
+    std::vector<char> buff(getChunkSize());
     off_t blen, offset;
     ssize_t retRead = 0;
-    std::map<uint64_t, std::pair<std::string, uint64_t>> contentStore;
     offset = off;
     do {
         if (offset >= fileSize) {
@@ -87,58 +283,446 @@ void read(off_t fileSize, off_t off, int threadID) {
         NDN_LOG_TRACE("[Thread " << threadID << "] Reading " << blen << "@"
                                  << offset);
 
-        retRead = consumer->Read(&buff[0], offset, blen);
-        contentStore[offset] = std::make_pair(std::string(buff), retRead);
+        retRead = readBlock(transfer, buff, offset, blen, threadID);
+        if (retRead < 0) {
+            transfer.failed = true;
+            break;
+        }
 
         offset += cmdLineOpts.bsize * cmdLineOpts.nthreads;
-    } while (retRead > 0);
+    } while (retRead > 0 && !transfer.failed);
+}
 
-    if (!cmdLineOpts.outfile.empty()) {
-        for (auto it = contentStore.begin(); it != contentStore.end();
-             it = contentStore.erase(it))
-            syncWrite->write(it->first, it->second.first.data(),
-                             it->second.second);
+/**
+ * @brief Copy one file over NDN
+ *
+ * @param infile Path of the file on the Producer side
+ * @param outfile Output file path. Empty if the file is only read
+ * @param session Session shared by all files of a batch. If empty, the file
+ * is copied over its own session
+ * @param nBytes The number of bytes copied
+ * @return int 0 on success, else 2
+ */
+int copyFile(const std::string &infile, const std::string &outfile,
+             std::shared_ptr<Session> session, uint64_t &nBytes) {
+    Transfer transfer;
+    transfer.consumer =
+        Consumer::getXrdNdnConsumerInstance(consumerOpts, std::move(session));
+    if (!transfer.consumer) {
+        std::cerr << "ERROR: Could not get xrdndnd consumer instance"
+                  << std::endl;
+        return 2;
     }
-}
 
-int copyFile() {
-    int ret = consumer->Open(cmdLineOpts.infile);
+    int ret = transfer.consumer->Open(infile);
     if (ret != XRDNDN_ESUCCESS) {
-        NDN_LOG_ERROR("Unable to open file: " << cmdLineOpts.infile << ". "
+        NDN_LOG_ERROR("Unable to open file: " << infile << ". "
                                               << strerror(abs(ret)));
         return 2;
     }
 
     struct stat info;
-    ret = consumer->Fstat(&info);
+    ret = transfer.consumer->Fstat(&info);
     if (ret != XRDNDN_ESUCCESS) {
         NDN_LOG_ERROR("Unable to get fstat for file: "
-                      << cmdLineOpts.infile << ". " << strerror(abs(ret)));
+                      << infile << ". " << strerror(abs(ret)));
         return 2;
     }
 
-    if (!cmdLineOpts.outfile.empty()) {
-        syncWrite = std::make_shared<SynchronizedWrite>(cmdLineOpts.outfile);
+    if (!setVerification(transfer, infile, info.st_size))
+        return 2;
+
+    if (!outfile.empty()) {
+        transfer.outputFile = std::make_shared<OutputFile>(outfile);
+        if (!transfer.outputFile->isOpened() ||
+            !transfer.outputFile->allocate(info.st_size))
+            return 2;
     }
     boost::thread_group threads;
 
     for (auto i = 0; i < cmdLineOpts.nthreads; ++i) {
-        threads.create_thread(
-            std::bind(read, info.st_size, cmdLineOpts.bsize * i, i));
+        threads.create_thread(std::bind(read, std::ref(transfer), info.st_size,
+                                        cmdLineOpts.bsize * i, i));
     }
 
     threads.join_all();
-    consumer->Close();
-    return 0;
+    transfer.consumer->Close();
+    nBytes = transfer.nBytes;
+
+    if (transfer.verify && !transfer.failed)
+        NDN_LOG_INFO("Verified " << nBytes << " bytes of file: " << infile);
+    return transfer.failed ? 2 : 0;
+}
+
+/**
+ * @brief Collect the files of a batch transfer from a file list, one path per
+ * line, or from a recursive walk of a local directory. Local paths are
+ * requested from the Producer as they are
+ *
+ */
+bool getBatchFiles(std::vector<std::string> &files) {
+    if (!cmdLineOpts.inputList.empty()) {
+        std::ifstream list(cmdLineOpts.inputList);
+        if (!list) {
+            std::cerr << "ERROR: Unable to open file list: "
+                      << cmdLineOpts.inputList << std::endl;
+            return false;
+        }
+
+        for (std::string line; std::getline(list, line);) {
+            if (!line.empty() && line[0] != '#')
+                files.emplace_back(line);
+        }
+        return true;
+    }
+
+    try {
+        for (boost::filesystem::recursive_directory_iterator it(
+                 cmdLineOpts.localInputDir),
+             end;
+             it != end; ++it) {
+            if (boost::filesystem::is_regular_file(it->status()))
+                files.emplace_back(it->path().string());
+        }
+    } catch (const boost::filesystem::filesystem_error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+/**
+ * @brief Output path of a file of a batch transfer: its path relative to the
+ * local input directory, or its full path for file lists, under the output
+ * directory
+ *
+ */
+std::string getBatchOutputFile(const std::string &infile) {
+    if (cmdLineOpts.outputDir.empty())
+        return std::string();
+
+    boost::filesystem::path relative(infile);
+    if (!cmdLineOpts.localInputDir.empty())
+        relative =
+            boost::filesystem::relative(infile, cmdLineOpts.localInputDir);
+    else
+        relative = relative.relative_path();
+
+    auto outfile = boost::filesystem::path(cmdLineOpts.outputDir) / relative;
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(outfile.parent_path(), ec);
+    return outfile.string();
 }
 
-int run() { return copyFile(); }
+/**
+ * @brief Copy many files concurrently over one shared session. Up to
+ * filesInFlight files are copied at a time and the aggregate throughput is
+ * reported at the end. A fetch failure stops the Pipeline of the session, so
+ * the files copied at that time fail and the next ones get a new session
+ *
+ */
+int copyBatch() {
+    std::vector<std::string> files;
+    if (!getBatchFiles(files))
+        return 2;
+
+    auto session = Session::getSession(consumerOpts);
+    if (!session) {
+        std::cerr << "ERROR: Could not get xrdndnd consumer session"
+                  << std::endl;
+        return 2;
+    }
+
+    boost::mutex mtxSession;
+    auto getSession = [&]() {
+        boost::lock_guard<boost::mutex> lock(mtxSession);
+        if (session->getPipeline().isStopped()) {
+            NDN_LOG_WARN("Pipeline stopped after a failure. Open a new session "
+                         "for the remaining files");
+            auto newSession = Session::getSession(consumerOpts);
+            if (newSession)
+                session = newSession;
+        }
+        return session;
+    };
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<size_t> nFailed(0);
+    std::atomic<uint64_t> nBytes(0);
+    auto startTime = ndn::time::steady_clock::now();
+
+    auto worker = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            uint64_t nFileBytes = 0;
+            if (copyFile(files[i], getBatchOutputFile(files[i]), getSession(),
+                         nFileBytes) != 0) {
+                ++nFailed;
+                std::cerr << "ERROR: Failed to copy file: " << files[i]
+                          << std::endl;
+            }
+            nBytes += nFileBytes;
+        }
+    };
+
+    boost::thread_group workers;
+    for (size_t i = 0; i < std::min<size_t>(cmdLineOpts.filesInFlight,
+                                            files.size());
+         ++i)
+        workers.create_thread(worker);
+    workers.join_all();
+
+    ndn::time::duration<double> elapsed =
+        ndn::time::steady_clock::now() - startTime;
+    double throughput = (8 * nBytes / 1000000.0) / elapsed.count();
+
+    std::cout << "Batch transfer over NDN completed"
+              << "\nFiles copied: " << files.size() - nFailed << "/"
+              << files.size() << "\nTime elapsed: " << elapsed.count() << " s"
+              << "\nTotal size: " << static_cast<double>(nBytes) / 1000000
+              << " MB"
+              << "\nThroughput: " << throughput << " Mbit/s"
+              << "\nPeak RSS: " << getPeakRss() << " MB" << std::endl;
+
+    session->stop();
+    return nFailed > 0 ? 2 : 0;
+}
+
+void benchmarkRead(Transfer &transfer, off_t fileSize, uint64_t byteLimit,
+                   std::atomic<uint64_t> &nextBlock,
+                   std::atomic<uint64_t> &nBytesIssued,
+                   const std::atomic<bool> &stop, int threadID) {
+    std::vector<char> buff(getChunkSize());
+    uint64_t nBlocks = (fileSize + cmdLineOpts.bsize - 1) / cmdLineOpts.bsize;
+
+    while (!stop && !transfer.failed) {
+        // The file is read over and over until the duration or the byte count
+        // is reached
+        off_t offset = (nextBlock++ % nBlocks) * cmdLineOpts.bsize;
+        off_t blen = std::min<off_t>(cmdLineOpts.bsize, fileSize - offset);
+        if (nBytesIssued.fetch_add(blen) >= byteLimit)
+            break;
+
+        if (readBlock(transfer, buff, offset, blen, threadID) < 0) {
+            transfer.failed = true;
+            break;
+        }
+    }
+}
+
+std::string jsonEscape(const std::string &str) {
+    std::string escaped;
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", c);
+            escaped += hex;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief Read a file over NDN and discard the Data, for a given duration, a
+ * given number of bytes or a single pass over the file. Throughput is reported
+ * every interval and, at the end, the segment latency percentiles and the
+ * retransmission, NACK and timeout counts of the Pipeline. The report can
+ * also be written as JSON
+ *
+ */
+int benchmark() {
+    auto session = Session::getSession(consumerOpts);
+    if (!session) {
+        std::cerr << "ERROR: Could not get xrdndnd consumer session"
+                  << std::endl;
+        return 2;
+    }
+
+    Transfer transfer;
+    transfer.consumer =
+        Consumer::getXrdNdnConsumerInstance(consumerOpts, session);
+    if (!transfer.consumer) {
+        std::cerr << "ERROR: Could not get xrdndnd consumer instance"
+                  << std::endl;
+        return 2;
+    }
+
+    int ret = transfer.consumer->Open(cmdLineOpts.infile);
+    if (ret != XRDNDN_ESUCCESS) {
+        NDN_LOG_ERROR("Unable to open file: " << cmdLineOpts.infile << ". "
+                                              << strerror(abs(ret)));
+        return 2;
+    }
+
+    struct stat info;
+    ret = transfer.consumer->Fstat(&info);
+    if (ret != XRDNDN_ESUCCESS || info.st_size == 0) {
+        NDN_LOG_ERROR("Unable to benchmark empty or unavailable file: "
+                      << cmdLineOpts.infile << ". " << strerror(abs(ret)));
+        return 2;
+    }
+
+    if (!setVerification(transfer, cmdLineOpts.infile, info.st_size))
+        return 2;
+
+    uint64_t byteLimit = cmdLineOpts.benchmarkBytes;
+    if (byteLimit == 0)
+        byteLimit = cmdLineOpts.benchmarkDuration > 0
+                        ? std::numeric_limits<uint64_t>::max()
+                        : static_cast<uint64_t>(info.st_size);
+
+    std::atomic<uint64_t> nextBlock(0);
+    std::atomic<uint64_t> nBytesIssued(0);
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> nRunning(cmdLineOpts.nthreads);
+
+    auto startTime = ndn::time::steady_clock::now();
+    boost::thread_group threads;
+    for (auto i = 0; i < cmdLineOpts.nthreads; ++i) {
+        threads.create_thread([&, i]() {
+            benchmarkRead(transfer, info.st_size, byteLimit, nextBlock,
+                          nBytesIssued, stop, i);
+            --nRunning;
+        });
+    }
+
+    using DoubleSeconds = ndn::time::duration<double>;
+    std::vector<std::pair<double, double>> samples; // (sec, Mbit/s)
+    auto lastReportTime = startTime;
+    uint64_t lastBytes = 0;
+
+    while (nRunning > 0) {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(
+            std::min<uint64_t>(cmdLineOpts.reportInterval, 50)));
+
+        auto now = ndn::time::steady_clock::now();
+        if (cmdLineOpts.benchmarkDuration > 0 &&
+            now - startTime >=
+                ndn::time::seconds(cmdLineOpts.benchmarkDuration))
+            stop = true;
+
+        if (now - lastReportTime <
+            ndn::time::milliseconds(cmdLineOpts.reportInterval))
+            continue;
+
+        uint64_t nBytes = session->getPipeline().getStatisticsSnapshot()
+                              .nBytesReceived;
+        double interval = DoubleSeconds(now - lastReportTime).count();
+        double elapsed = DoubleSeconds(now - startTime).count();
+        double throughput = (8 * (nBytes - lastBytes) / 1000000.0) / interval;
+        samples.emplace_back(elapsed, throughput);
+        std::cout << "[" << elapsed << " s] " << throughput << " Mbit/s"
+                  << std::endl;
+
+        lastReportTime = now;
+        lastBytes = nBytes;
+    }
+
+    threads.join_all();
+    double elapsed =
+        DoubleSeconds(ndn::time::steady_clock::now() - startTime).count();
+    transfer.consumer->Close();
+
+    auto statistics = session->getPipeline().getStatisticsSnapshot();
+    double throughput =
+        (8 * statistics.nBytesReceived / 1000000.0) / elapsed;
+    auto toMs = [&](double percentile) {
+        return statistics.latency.getPercentile(percentile) / 1000.0;
+    };
+
+    std::cout << "Benchmark over NDN for file: " << cmdLineOpts.infile
+              << (transfer.failed ? " failed" : " completed")
+              << "\nTime elapsed: " << elapsed << " s"
+              << "\nTotal # of segments received: "
+              << statistics.nSegmentsReceived << "\nTotal size: "
+              << static_cast<double>(statistics.nBytesReceived) / 1000000
+              << " MB"
+              << "\nThroughput: " << throughput << " Mbit/s"
+              << "\nSegment latency p50: " << toMs(50)
+              << " ms, p90: " << toMs(90) << " ms, p99: " << toMs(99)
+              << " ms, p99.9: " << toMs(99.9) << " ms"
+              << "\nRetransmissions: " << statistics.nRetransmissions
+              << ", NACKs: " << statistics.nNacks
+              << ", Timeouts: " << statistics.nTimeouts
+              << ", Failed segments: " << statistics.nFailures
+              << "\nHedged Interests: " << statistics.nHedges
+              << ", won: " << statistics.nHedgesWon
+              << "\nPeak RSS: " << getPeakRss() << " MB" << std::endl;
+
+    if (!cmdLineOpts.jsonFile.empty()) {
+        std::ofstream jsonFile;
+        if (cmdLineOpts.jsonFile != "-")
+            jsonFile.open(cmdLineOpts.jsonFile);
+        std::ostream &json = cmdLineOpts.jsonFile == "-" ? std::cout : jsonFile;
+        if (!json) {
+            std::cerr << "ERROR: Unable to write JSON report to: "
+                      << cmdLineOpts.jsonFile << std::endl;
+            return 2;
+        }
+
+        json << "{\n  \"file\": \"" << jsonEscape(cmdLineOpts.infile)
+             << "\",\n  \"fileSize\": " << info.st_size
+             << ",\n  \"pipelineSize\": " << consumerOpts.pipelineSize
+             << ",\n  \"interestLifetime\": " << consumerOpts.interestLifetime
+             << ",\n  \"readahead\": " << consumerOpts.readahead
+             << ",\n  \"bsize\": " << cmdLineOpts.bsize
+             << ",\n  \"nthreads\": " << cmdLineOpts.nthreads
+             << ",\n  \"success\": " << (transfer.failed ? "false" : "true")
+             << ",\n  \"elapsedSec\": " << elapsed
+             << ",\n  \"segments\": " << statistics.nSegmentsReceived
+             << ",\n  \"bytes\": " << statistics.nBytesReceived
+             << ",\n  \"throughputMbps\": " << throughput
+             << ",\n  \"latencyUs\": {\"p50\": "
+             << statistics.latency.getPercentile(50)
+             << ", \"p90\": " << statistics.latency.getPercentile(90)
+             << ", \"p99\": " << statistics.latency.getPercentile(99)
+             << ", \"p99.9\": " << statistics.latency.getPercentile(99.9)
+             << ", \"mean\": " << statistics.latency.getMean()
+             << ", \"max\": " << statistics.latency.getMax() << "}"
+             << ",\n  \"retransmissions\": " << statistics.nRetransmissions
+             << ",\n  \"nacks\": " << statistics.nNacks
+             << ",\n  \"timeouts\": " << statistics.nTimeouts
+             << ",\n  \"failedSegments\": " << statistics.nFailures
+             << ",\n  \"hedges\": " << statistics.nHedges
+             << ",\n  \"hedgesWon\": " << statistics.nHedgesWon
+             << ",\n  \"peakRssMB\": " << getPeakRss()
+             << ",\n  \"samples\": [";
+        for (size_t i = 0; i < samples.size(); ++i) {
+            json << (i == 0 ? "\n" : ",\n") << "    {\"timeSec\": "
+                 << samples[i].first
+                 << ", \"throughputMbps\": " << samples[i].second << "}";
+        }
+        json << "\n  ]\n}" << std::endl;
+    }
+
+    session->stop();
+    return transfer.failed ? 2 : 0;
+}
+
+int run() {
+    if (cmdLineOpts.benchmark)
+        return benchmark();
+
+    if (!cmdLineOpts.inputList.empty() || !cmdLineOpts.localInputDir.empty())
+        return copyBatch();
+
+    uint64_t nBytes;
+    int ret =
+        copyFile(cmdLineOpts.infile, cmdLineOpts.outfile, nullptr, nBytes);
+    std::cout << "Peak RSS: " << getPeakRss() << " MB" << std::endl;
+    return ret;
+}
 
 static void usage(std::ostream &os, const std::string &programName,
                   const boost::program_options::options_description &desc) {
     os << "Usage: " << programName
-       << " [options]\nNote: This application needs --input-file argument "
-          "specified\n\n"
+       << " [options]\nNote: This application needs --input-file, "
+          "--input-list or --local-input-dir argument specified\n\n"
        << desc;
 }
 
@@ -154,15 +738,73 @@ int main(int argc, char **argv) {
 
     boost::program_options::options_description description("Options", 120);
     description.add_options()(
+        "benchmark",
+        boost::program_options::bool_switch(&cmdLineOpts.benchmark),
+        "Benchmark mode: read --input-file and discard the Data. Reports "
+        "throughput over time, segment latency percentiles, retransmissions, "
+        "NACKs and timeouts. By default the file is read once")(
         "bsize",
         boost::program_options::value<uint64_t>(&cmdLineOpts.bsize)
             ->default_value(cmdLineOpts.bsize)
             ->implicit_value(cmdLineOpts.bsize),
-        "Read buffer size in bytes. Specify any value between 8KB and 1GB in "
-        "bytes")("help,h", "Print this help message and exit")(
+        "Block size in bytes read by each thread in turn. Blocks are read in "
+        "chunks of at most one Pipeline window, so memory does not grow with "
+        "it. Specify any value between 8KB and 1GB in bytes")(
+        "bytes",
+        boost::program_options::value<uint64_t>(&cmdLineOpts.benchmarkBytes),
+        "Benchmark mode: stop after reading this many bytes, reading the file "
+        "over and over")(
+        "combined-open",
+        boost::program_options::bool_switch(&consumerOpts.combinedOpen),
+        "Open the file with a single Interest that also returns the file stat "
+        "and, for small files, the first segment. The Producer must support "
+        "combined open")(
+        "duration",
+        boost::program_options::value<uint64_t>(
+            &cmdLineOpts.benchmarkDuration),
+        "Benchmark mode: run for this many seconds, reading the file over and "
+        "over")(
+        "file-handles",
+        boost::program_options::bool_switch(&consumerOpts.fileHandles),
+        "Name read Interests by the compact file handle returned by the "
+        "Producer with the combined open, instead of by the file path. "
+        "Implies --combined-open")(
+        "files-in-flight",
+        boost::program_options::value<uint16_t>(&cmdLineOpts.filesInFlight)
+            ->default_value(cmdLineOpts.filesInFlight)
+            ->implicit_value(cmdLineOpts.filesInFlight),
+        "Number of files copied concurrently in batch mode")(
+        "hedge-budget",
+        boost::program_options::value<double>(&consumerOpts.hedgeBudget)
+            ->default_value(consumerOpts.hedgeBudget),
+        std::string("Maximum number of hedged Interests, in percent of the "
+                    "Interests expressed. Specify any value between 0 and " +
+                    std::to_string(XRDNDN_MAXHEDGE_BUDGET))
+            .c_str())(
+        "hedge-forwarding-hint",
+        boost::program_options::value<std::string>(
+            &consumerOpts.hedgeForwardingHint),
+        "Forwarding hint set on hedged Interests, so that they may take "
+        "another path to the Producer")(
+        "hedge-percentile",
+        boost::program_options::value<double>(&consumerOpts.hedgePercentile)
+            ->default_value(consumerOpts.hedgePercentile),
+        "Express a duplicate Interest for segments still outstanding past this "
+        "percentile of the recent RTTs. The first Data received wins. Specify "
+        "any value between 50 and 99.9. 0 disables hedging")(
+        "help,h", "Print this help message and exit")(
         "input-file",
         boost::program_options::value<std::string>(&cmdLineOpts.infile),
         "Path to file to be copied over Name Data Networking")(
+        "input-list",
+        boost::program_options::value<std::string>(&cmdLineOpts.inputList),
+        "Batch mode: copy all files listed in this file, one path per line, "
+        "over one shared NDN face and Pipeline")(
+        "json",
+        boost::program_options::value<std::string>(&cmdLineOpts.jsonFile)
+            ->implicit_value("-"),
+        "Benchmark mode: write the report as JSON to this file, or to stdout "
+        "if no file is given")(
         "interest-lifetime",
         boost::program_options::value<size_t>(&consumerOpts.interestLifetime)
             ->default_value(XRDNDN_DEFAULT_INTEREST_LIFETIME)
@@ -172,6 +814,13 @@ int main(int argc, char **argv) {
                     std::to_string(XRDNDN_MININTEREST_LIFETIME) + " and " +
                     std::to_string(XRDNDN_MAXINTEREST_LIFETIME))
             .c_str())(
+        "local-input-dir",
+        boost::program_options::value<std::string>(&cmdLineOpts.localInputDir),
+        "Batch mode: copy all files found under this directory of the local "
+        "file system, recursively, over one shared NDN face and Pipeline. The "
+        "local paths are requested from the Producer as they are, thus the "
+        "directory must hold the same files as the Producer, e.g. a shared "
+        "mount. Use --input-list for files known only to the Producer")(
         "log-level",
         boost::program_options::value<std::string>(&consumerOpts.logLevel)
             ->default_value(consumerOpts.logLevel)
@@ -189,6 +838,10 @@ int main(int argc, char **argv) {
             ->default_value("")
             ->implicit_value("./ndnfile.out"),
         "Path to output file copied over Name Data Networking")(
+        "output-dir",
+        boost::program_options::value<std::string>(&cmdLineOpts.outputDir),
+        "Batch mode: directory where the copied files are written, under "
+        "their path relative to --local-input-dir or their full path")(
         "pipeline-size",
         boost::program_options::value<size_t>(&consumerOpts.pipelineSize)
             ->default_value(XRDNDN_DEFAULT_PIPELINESZ)
@@ -199,7 +852,28 @@ int main(int argc, char **argv) {
             "the fixed window size Pipeline. Specify any value between " +
             std::to_string(XRDNDN_MINPIPELINESZ) + " and " +
             std::to_string(XRDNDN_MAXPIPELINESZ))
-            .c_str())("version,V", "Show version information and exit");
+            .c_str())(
+        "readahead",
+        boost::program_options::value<size_t>(&consumerOpts.readahead)
+            ->default_value(XRDNDN_DEFAULT_READAHEAD)
+            ->implicit_value(XRDNDN_DEFAULT_READAHEAD),
+        std::string("Maximum number of segments fetched ahead of sequential "
+                    "reads. The depth adapts to the measured bandwidth-delay "
+                    "product. Specify any value between " +
+                    std::to_string(XRDNDN_MINREADAHEAD) + " and " +
+                    std::to_string(XRDNDN_MAXREADAHEAD) + ". 0 disables it")
+            .c_str())(
+        "report-interval",
+        boost::program_options::value<uint64_t>(&cmdLineOpts.reportInterval)
+            ->default_value(cmdLineOpts.reportInterval)
+            ->implicit_value(cmdLineOpts.reportInterval),
+        "Benchmark mode: throughput report interval in milliseconds")(
+        "verify-synthetic",
+        boost::program_options::bool_switch(&cmdLineOpts.verifySynthetic),
+        "Check the content of synthetic files /synthetic/<size>/<seed> "
+        "against the expected generated content. The Producer must be "
+        "started with synthetic files enabled")(
+        "version,V", "Show version information and exit");
 
     boost::program_options::variables_map vm;
     try {
@@ -235,12 +909,42 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (vm.count("input-file") == 0) {
-        std::cerr << "ERROR: Specify file to be copied over NDN" << std::endl;
+    if (vm.count("input-file") + vm.count("input-list") +
+            vm.count("local-input-dir") !=
+        1) {
+        std::cerr << "ERROR: Specify exactly one of --input-file, "
+                     "--input-list or --local-input-dir"
+                  << std::endl;
         usage(std::cerr, programName, description);
         return 2;
     }
 
+    if (cmdLineOpts.benchmark && vm.count("input-file") == 0) {
+        std::cerr << "ERROR: Benchmark mode needs --input-file" << std::endl;
+        return 2;
+    }
+
+    if (cmdLineOpts.verifySynthetic && vm.count("local-input-dir") > 0) {
+        std::cerr << "ERROR: Synthetic files can not be listed from a "
+                     "directory, use --input-file or --input-list"
+                  << std::endl;
+        return 2;
+    }
+
+    if (cmdLineOpts.reportInterval < 1) {
+        std::cerr << "ERROR: Report interval must be at least 1 ms"
+                  << std::endl;
+        return 2;
+    }
+
+    if (vm.count("files-in-flight") > 0) {
+        if (cmdLineOpts.filesInFlight < 1) {
+            std::cerr << "ERROR: Files in flight must be at least 1"
+                      << std::endl;
+            return 2;
+        }
+    }
+
     if (vm.count("interest-lifetime") > 0) {
         if (consumerOpts.interestLifetime < XRDNDN_MININTEREST_LIFETIME ||
             consumerOpts.interestLifetime > XRDNDN_MAXINTEREST_LIFETIME) {
@@ -262,6 +966,31 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (consumerOpts.hedgePercentile != 0 &&
+        (consumerOpts.hedgePercentile < XRDNDN_MINHEDGE_PERCENTILE ||
+         consumerOpts.hedgePercentile > XRDNDN_MAXHEDGE_PERCENTILE)) {
+        std::cerr << "ERROR: Hedge percentile must be 0 or between "
+                  << XRDNDN_MINHEDGE_PERCENTILE << " and "
+                  << XRDNDN_MAXHEDGE_PERCENTILE << std::endl;
+        return 2;
+    }
+
+    if (consumerOpts.hedgeBudget < 0 ||
+        consumerOpts.hedgeBudget > XRDNDN_MAXHEDGE_BUDGET) {
+        std::cerr << "ERROR: Hedge budget must be between 0 and "
+                  << XRDNDN_MAXHEDGE_BUDGET << std::endl;
+        return 2;
+    }
+
+    if (vm.count("readahead") > 0) {
+        if (consumerOpts.readahead > XRDNDN_MAXREADAHEAD) {
+            std::cerr << "ERROR: Readahead must be between "
+                      << std::to_string(XRDNDN_MINREADAHEAD) << " and "
+                      << std::to_string(XRDNDN_MAXREADAHEAD) << std::endl;
+            return 2;
+        }
+    }
+
     if (boost::filesystem::exists(
             boost::filesystem::path(cmdLineOpts.infile))) {
         cmdLineOpts.infile =
@@ -270,6 +999,21 @@ int main(int argc, char **argv) {
                 .string();
     }
 
+    if (!cmdLineOpts.localInputDir.empty()) {
+        boost::system::error_code ec;
+        if (!boost::filesystem::is_directory(cmdLineOpts.localInputDir, ec)) {
+            std::cerr << "ERROR: --local-input-dir: "
+                      << cmdLineOpts.localInputDir
+                      << " is not a directory of the local file system. Files "
+                         "known only to the Producer must be given with "
+                         "--input-list"
+                      << std::endl;
+            return 2;
+        }
+        cmdLineOpts.localInputDir =
+            boost::filesystem::canonical(cmdLineOpts.localInputDir).string();
+    }
+
     if (!cmdLineOpts.outfile.empty())
         cmdLineOpts.outfile =
             boost::filesystem::path(cmdLineOpts.outfile).string();
@@ -296,18 +1040,30 @@ int main(int argc, char **argv) {
         std::cout << "Selected Options: Read buffer size: " << cmdLineOpts.bsize
                   << "B, Pipeline Size: " << consumerOpts.pipelineSize
                   << ", Interest lifetime: " << consumerOpts.interestLifetime
-                  << "s, Input file: " << cmdLineOpts.infile
-                  << ", Output file: "
-                  << (cmdLineOpts.outfile.empty() ? "N/D" : cmdLineOpts.outfile)
-                  << std::endl;
+                  << "s, Readahead: " << consumerOpts.readahead
+                  << ", Combined open: " << consumerOpts.combinedOpen
+                  << ", File handles: " << consumerOpts.fileHandles
+                  << ", Hedge percentile: " << consumerOpts.hedgePercentile
+                  << ", Hedge budget: " << consumerOpts.hedgeBudget << "%"
+                  << ", Verify synthetic: " << cmdLineOpts.verifySynthetic;
+        if (!cmdLineOpts.infile.empty())
+            std::cout << ", Input file: " << cmdLineOpts.infile
+                      << ", Output file: "
+                      << (cmdLineOpts.outfile.empty() ? "N/D"
+                                                      : cmdLineOpts.outfile);
+        else
+            std::cout << ", Input: "
+                      << (cmdLineOpts.inputList.empty()
+                              ? cmdLineOpts.localInputDir
+                              : cmdLineOpts.inputList)
+                      << ", Files in flight: " << cmdLineOpts.filesInFlight
+                      << ", Output directory: "
+                      << (cmdLineOpts.outputDir.empty()
+                              ? "N/D"
+                              : cmdLineOpts.outputDir);
+        std::cout << std::endl;
     }
 
-    consumer = Consumer::getXrdNdnConsumerInstance(consumerOpts);
-    if (!consumer) {
-        std::cerr << "ERROR: Could not get xrdndnd consumer instance"
-                  << std::endl;
-        return 2;
-    }
     return run();
 }
 } // namespace xrdndnconsumer
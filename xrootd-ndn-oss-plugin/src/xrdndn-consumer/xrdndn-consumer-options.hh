@@ -54,6 +54,43 @@ namespace xrdndnconsumer {
  *
  */
 #define XRDNDN_MAXPIPELINESZ 512 // Interests
+/**
+ * @brief Minimum readahead depth set from options. 0 disables readahead
+ *
+ */
+#define XRDNDN_MINREADAHEAD 0 // Segments
+/**
+ * @brief Default maximum readahead depth
+ *
+ */
+#define XRDNDN_DEFAULT_READAHEAD 256 // Segments
+/**
+ * @brief Maximum readahead depth set from options
+ *
+ */
+#define XRDNDN_MAXREADAHEAD 4096 // Segments
+/**
+ * @brief Minimum percentile of recent RTTs after which a hedged Interest is
+ * expressed, set from options. 0 disables hedging
+ *
+ */
+#define XRDNDN_MINHEDGE_PERCENTILE 50 // Percentile
+/**
+ * @brief Maximum percentile of recent RTTs after which a hedged Interest is
+ * expressed, set from options
+ *
+ */
+#define XRDNDN_MAXHEDGE_PERCENTILE 99.9 // Percentile
+/**
+ * @brief Default hedge budget
+ *
+ */
+#define XRDNDN_DEFAULT_HEDGE_BUDGET 5 // Percent of Interests
+/**
+ * @brief Maximum hedge budget set from options
+ *
+ */
+#define XRDNDN_MAXHEDGE_BUDGET 50 // Percent of Interests
 
 /**
  * @brief XRootD NDN Consumer instance options
@@ -73,6 +110,53 @@ struct Options {
      */
     size_t interestLifetime = XRDNDN_DEFAULT_INTEREST_LIFETIME;
 
+    /**
+     * @brief The maximum number of segments fetched ahead of a sequential
+     * reader. The actual depth adapts to the measured bandwidth-delay product
+     * and never exceeds this value. 0 disables readahead
+     *
+     */
+    size_t readahead = XRDNDN_DEFAULT_READAHEAD;
+
+    /**
+     * @brief Open files with a single Interest whose Data also carries the
+     * file stat and, for small files, the first segment. Requires a Producer
+     * that answers combined open Interests
+     *
+     */
+    bool combinedOpen = false;
+
+    /**
+     * @brief Name read Interests by the compact file handle returned by the
+     * Producer in reply to the combined open, instead of by the file path.
+     * Implies combinedOpen. File paths are used if the Producer returns no
+     * handle
+     *
+     */
+    bool fileHandles = false;
+
+    /**
+     * @brief Express a duplicate Interest with a new nonce for segments still
+     * outstanding past this percentile of the recently observed RTTs. The
+     * first Data received wins. 0 disables hedging
+     *
+     */
+    double hedgePercentile = 0;
+
+    /**
+     * @brief The maximum number of hedged Interests, in percent of the
+     * Interests expressed by the Pipeline
+     *
+     */
+    double hedgeBudget = XRDNDN_DEFAULT_HEDGE_BUDGET;
+
+    /**
+     * @brief Forwarding hint set on hedged Interests, so that they may take
+     * another path to the Producer. Empty to hedge on the same path
+     *
+     */
+    std::string hedgeForwardingHint;
+
     /**
      * @brief Log level: TRACE DEBUG INFO WARN ERROR FATAL. More information is
      * available at:
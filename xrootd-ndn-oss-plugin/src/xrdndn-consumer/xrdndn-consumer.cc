@@ -19,6 +19,7 @@
  *****************************************************************************/
 
 #include <algorithm>
+#include <limits>
 
 #include "../common/xrdndn-logger.hh"
 #include "../common/xrdndn-utils.hh"
@@ -27,9 +28,12 @@
 using namespace ndn;
 
 namespace xrdndnconsumer {
+const size_t Consumer::MAX_EDGE_SEGMENTS = 16;
+
 std::shared_ptr<Consumer>
-Consumer::getXrdNdnConsumerInstance(const Options &opts) {
-    auto consumer = std::make_shared<Consumer>(opts);
+Consumer::getXrdNdnConsumerInstance(const Options &opts,
+                                    std::shared_ptr<Session> session) {
+    auto consumer = std::make_shared<Consumer>(opts, std::move(session));
 
     if (!consumer || consumer->m_error) {
         NDN_LOG_FATAL("Unable to get XRootD NDN Consumer object instance");
@@ -39,34 +43,34 @@ Consumer::getXrdNdnConsumerInstance(const Options &opts) {
     return consumer;
 }
 
-Consumer::Consumer(const Options &opts)
+Consumer::Consumer(const Options &opts, std::shared_ptr<Session> session)
     : m_options(opts), m_interestLifetime(opts.interestLifetime),
-      m_validator(security::v2::getAcceptAllValidator()), m_error(false) {
+      m_session(std::move(session)),
+      m_ownsSession(!m_session), m_pipeline(nullptr), m_error(false),
+      m_hasStat(false), m_nSegments(std::numeric_limits<uint64_t>::max()),
+      m_readahead(opts.readahead), m_nextOffset(0), m_readaheadNext(0),
+      m_nSegmentsPrefetched(0), m_nReadaheadHits(0), m_nEdgeSegmentsReused(0) {
     setLogLevel();
     NDN_LOG_TRACE("Alloc XRootD NDN Consumer");
 
-    m_pipeline = std::make_shared<Pipeline>(m_face, m_options.pipelineSize);
-    if (!m_pipeline) {
+    if (m_ownsSession)
+        m_session = Session::getSession(m_options);
+
+    if (!m_session || m_session->hasError()) {
         m_error = true;
-        NDN_LOG_ERROR("Unable to get Pipeline object instance");
+        NDN_LOG_ERROR("Unable to get Consumer session");
         return;
     }
-
-    processEvents(false);
-
-    if (!m_error) {
-        faceProcessEventsThread =
-            boost::thread(std::bind(&Consumer::processEvents, this, true));
-    }
+    m_pipeline = &m_session->getPipeline();
 }
 
 Consumer::~Consumer() {
-    if (m_pipeline)
-        m_pipeline->stop();
-
-    m_face.removeAllPendingInterests();
-    m_face.shutdown();
-    faceProcessEventsThread.join();
+    // Outstanding prefetches complete on the Consumer itself. A private
+    // session is stopped, which cancels them. A shared one keeps running, so
+    // they are waited for
+    if (m_ownsSession && m_session)
+        m_session->stop();
+    m_nPrefetching.wait();
 }
 
 void Consumer::setLogLevel() {
@@ -81,54 +85,45 @@ void Consumer::setLogLevel() {
     }
 }
 
-void Consumer::processEvents(bool keepThread) {
-    try {
-        m_face.processEvents(time::milliseconds::zero(), keepThread);
-    } catch (const std::exception &e) {
-        NDN_LOG_ERROR("Catch exception: "
-                      << e.what() << " while processing NDN face events");
-        m_error = true;
-        m_pipeline->stop();
-    }
+const Interest Consumer::getInterest(const ndn::Name &prefix) {
+    return getInterestForName(xrdndn::Utils::getName(prefix, m_path));
 }
 
-const Interest Consumer::getInterest(ndn::Name prefix, uint64_t segmentNo) {
-    auto name = xrdndn::Utils::getName(prefix, m_path, segmentNo);
+InterestSpec
+Consumer::getReadSpec(const std::shared_ptr<const ndn::Name> &prefix) {
+    InterestSpec spec;
+    spec.prefix = prefix;
+    spec.mustBeFresh = prefix == m_pathPrefix;
+    spec.lifetime = m_interestLifetime;
+    return spec;
+}
 
+const Interest Consumer::getInterestForName(const ndn::Name &name,
+                                            bool mustBeFresh) {
     Interest interest(name);
     interest.setInterestLifetime(m_interestLifetime);
-    interest.setMustBeFresh(true);
+    interest.setMustBeFresh(mustBeFresh);
     interest.setDefaultCanBePrefix(false);
     return interest;
 }
 
-int Consumer::validateData(const int errcode, const Interest &interest,
-                           const Data &data) {
-    NDN_LOG_TRACE("Validating Data for Interest: " << interest);
+void Consumer::SingleRequest::onComplete(uint64_t, int errcode,
+                                         const ndn::Block &content) {
+    this->errcode = errcode;
+    this->content = content;
+    latch.countDown();
+}
 
-    if (errcode != XRDNDN_ESUCCESS) {
-        NDN_LOG_ERROR("Error occured while procesing Interest: " << interest);
-        return errcode;
+int Consumer::fetchOne(const ndn::Interest &interest, ndn::Block &content) {
+    SingleRequest request;
+    if (!m_pipeline->insert(interest, 0, &request)) {
+        NDN_LOG_ERROR("Pipeline refused Interest: " << interest);
+        return -ECONNABORTED;
     }
 
-    int retValidate = XRDNDN_ESUCCESS;
-    m_validator.validate(
-        data,
-        [&](const Data &data) {
-            if (data.getContentType() == ndn::tlv::ContentType_Nack) {
-                NDN_LOG_ERROR("Received application level NACK for Interest: "
-                              << interest);
-                retValidate = -readNonNegativeInteger(data.getContent());
-            }
-        },
-        [&](const Data &, const security::v2::ValidationError &error) {
-            NDN_LOG_ERROR("Error: " << error.getInfo()
-                                    << " while validating Data for Interest: "
-                                    << interest);
-            retValidate = XRDNDN_EFAILURE;
-        });
-
-    return retValidate;
+    request.latch.wait();
+    content = request.content;
+    return request.errcode;
 }
 
 /*****************************************************************************/
@@ -141,46 +136,207 @@ int Consumer::Open(std::string path) {
         return -ENOENT;
     }
     m_path = path;
+    m_pathPrefix = std::make_shared<const ndn::Name>(
+        xrdndn::Utils::getFilePrefix(xrdndn::SYS_CALL_READ_PREFIX_URI, m_path));
+    std::atomic_store(&m_readPrefix, m_pathPrefix);
+
+    // File handles are returned with the combined open only
+    if (m_options.combinedOpen || m_options.fileHandles)
+        return this->openStat();
 
     auto openInterest = this->getInterest(xrdndn::SYS_CALL_OPEN_PREFIX_URI);
 
     NDN_LOG_INFO("Request open file: " << m_path
                                        << " with Interest: " << openInterest);
 
-    FutureType future = m_pipeline->insert(openInterest);
-    if (!future.valid()) {
-        NDN_LOG_ERROR("Received invalid future for open request");
-        return -ECONNABORTED;
-    }
+    ndn::Block content;
+    int retOpen = this->fetchOne(openInterest, content);
 
-    try {
-        future.wait();
-    } catch (const std::exception &e) {
-        NDN_LOG_ERROR("Catch exception: "
-                      << e.what()
-                      << " while waiting for future on open request");
-        return -ECONNABORTED;
+    if (retOpen == XRDNDN_ESUCCESS) {
+        retOpen = -readNonNegativeInteger(content);
     }
 
-    DataTypeTuple openResult = future.get();
-    int retOpen = validateData(std::get<0>(openResult), std::get<1>(openResult),
-                               std::get<2>(openResult));
+    NDN_LOG_INFO("Open file: " << m_path << " with error code: " << retOpen);
+
+    return retOpen;
+}
+
+int Consumer::openStat() {
+    auto openStatInterest =
+        this->getInterest(xrdndn::SYS_CALL_OPEN_STAT_PREFIX_URI);
+
+    NDN_LOG_INFO("Request combined open for file: "
+                 << m_path << " with Interest: " << openStatInterest);
+
+    ndn::Block content;
+    int retOpen = this->fetchOne(openStatInterest, content);
+    return this->applyOpenStat(retOpen, content);
+}
+
+InterestSpec Consumer::getOpenStatSpec() {
+    InterestSpec spec;
+    spec.prefix = std::make_shared<const ndn::Name>(xrdndn::Utils::getName(
+        xrdndn::SYS_CALL_OPEN_STAT_PREFIX_URI, m_path));
+    spec.appendSegment = false;
+    spec.lifetime = m_interestLifetime;
+    return spec;
+}
+
+int Consumer::applyOpenStat(int retOpen, ndn::Block &content) {
+    bool hasStat = false;
+    bool hasSegment = false;
+    bool hasVersion = false;
+    auto readPrefix = m_pathPrefix;
+    std::shared_ptr<const ndn::Name> handlePrefix;
 
     if (retOpen == XRDNDN_ESUCCESS) {
-        retOpen = -readNonNegativeInteger(std::get<2>(openResult).getContent());
+        try {
+            content.parse();
+        } catch (const ndn::Block::Error &e) {
+            NDN_LOG_ERROR("Malformed combined open Data for file: "
+                          << m_path << ": " << e.what());
+            retOpen = -EBADMSG;
+        }
     }
 
-    NDN_LOG_INFO("Open file: " << m_path << " with error code: " << retOpen);
+    if (retOpen == XRDNDN_ESUCCESS) {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        for (const auto &element : content.elements()) {
+            if (element.type() == XRDNDN_TLV_STAT &&
+                element.value_size() == sizeof(struct stat)) {
+                memcpy(&m_stat, element.value(), sizeof(struct stat));
+                m_hasStat = true;
+                hasStat = true;
+                setFileSize(m_stat.st_size);
+            } else if (element.type() == XRDNDN_TLV_SEGMENT) {
+                storeEdgeSegment(0, element);
+                hasSegment = true;
+            } else if (element.type() == XRDNDN_TLV_FILE_HANDLE &&
+                       m_options.fileHandles) {
+                try {
+                    auto handle = std::make_shared<ndn::Name>(
+                        xrdndn::SYS_CALL_READ_PREFIX_URI);
+                    handle->append(ndn::Name(element.blockFromValue()));
+                    handlePrefix = handle;
+                } catch (const ndn::tlv::Error &e) {
+                    NDN_LOG_WARN("Malformed file handle for file: "
+                                 << m_path << ": " << e.what());
+                }
+            } else if (element.type() == XRDNDN_TLV_FILE_VERSION) {
+                try {
+                    readPrefix = std::make_shared<const ndn::Name>(
+                        ndn::Name(*m_pathPrefix)
+                            .appendVersion(readNonNegativeInteger(element)));
+                    hasVersion = true;
+                } catch (const ndn::tlv::Error &e) {
+                    NDN_LOG_WARN("Malformed file version for file: "
+                                 << m_path << ": " << e.what());
+                }
+            }
+        }
+    }
+    if (handlePrefix)
+        readPrefix = handlePrefix;
+    std::atomic_store(&m_readPrefix, readPrefix);
+
+    NDN_LOG_INFO("Combined open file: "
+                 << m_path << " with error code: " << retOpen
+                 << (hasStat ? ", stat" : "")
+                 << (hasSegment ? ", first segment" : "")
+                 << (hasVersion ? ", file version" : "")
+                 << (handlePrefix ? ", file handle" : "")
+                 << " included");
 
     return retOpen;
 }
 
+void Consumer::RenewRequest::onComplete(uint64_t, int errcode,
+                                        const ndn::Block &content) {
+    ndn::Block openStatContent(content);
+    consumer.applyOpenStat(errcode, openStatContent);
+
+    auto onDone = std::move(callback);
+    delete this;
+    onDone(true);
+}
+
+bool Consumer::renewFileHandle(const std::shared_ptr<const ndn::Name> &stale) {
+    CountdownLatch latch(1);
+    bool renewed = false;
+    this->renewFileHandleAsync(stale, [&](bool ret) {
+        renewed = ret;
+        latch.countDown();
+    });
+
+    latch.wait();
+    return renewed;
+}
+
+void Consumer::renewFileHandleAsync(
+    const std::shared_ptr<const ndn::Name> &stale,
+    RenewRequest::Callback callback) {
+    if (stale == m_pathPrefix) {
+        callback(false);
+        return;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(m_mtxFileHandle);
+        // Already renewed, or being renewed, by another reader. In the latter
+        // case reads use the file path meanwhile
+        if (std::atomic_load(&m_readPrefix) != stale) {
+            lock.unlock();
+            callback(true);
+            return;
+        }
+
+        std::atomic_store(&m_readPrefix, m_pathPrefix);
+        // Segments kept from the old file version must not be served. The
+        // combined open stores the new first segment after this
+        boost::unique_lock<boost::mutex> lockSegments(m_mtxSegments);
+        this->dropReadahead();
+        this->clearEdgeSegments();
+    }
+
+    NDN_LOG_INFO("File handle: " << *stale << " of file: " << m_path
+                                 << " is stale. Open the file again");
+    auto request = new RenewRequest(*this, std::move(callback));
+    request->spec = this->getOpenStatSpec();
+    this->requestRenew(*request);
+}
+
+void Consumer::requestRenew(RenewRequest &request) {
+    if (m_pipeline->tryInsert(request.spec, 0, &request))
+        return;
+
+    if (m_pipeline->waitForSlot(
+            [this, &request]() { this->requestRenew(request); }))
+        return;
+
+    NDN_LOG_ERROR("Pipeline refused combined open for file: " << m_path);
+    request.onComplete(0, -ECONNABORTED, ndn::Block());
+}
+
 /*****************************************************************************/
 /*                                 C l o s e                                 */
 /*****************************************************************************/
 int Consumer::Close() {
+    {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        dropReadahead();
+        clearEdgeSegments();
+        NDN_LOG_INFO("Readahead for file: " << m_path << " prefetched "
+                                            << m_nSegmentsPrefetched
+                                            << " segments with "
+                                            << m_nReadaheadHits << " hits");
+        NDN_LOG_INFO("Reused edge segments for file: "
+                     << m_path << " saved " << m_nEdgeSegmentsReused
+                     << " segment fetches");
+    }
+
     NDN_LOG_INFO("Close file: " << m_path << " with error code: 0");
-    m_pipeline->getStatistics(m_path);
+    if (m_ownsSession)
+        m_pipeline->getStatistics(m_path);
     return XRDNDN_ESUCCESS;
 }
 
@@ -188,34 +344,27 @@ int Consumer::Close() {
 /*                                F s t a t                                  */
 /*****************************************************************************/
 int Consumer::Fstat(struct stat *buff) {
+    {
+        // The stat is written again when the file handle is renewed
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        if (m_hasStat) {
+            memcpy(buff, &m_stat, sizeof(struct stat));
+            NDN_LOG_INFO("Fstat file: " << m_path << " from combined open");
+            return XRDNDN_ESUCCESS;
+        }
+    }
+
     auto fstatInterest = this->getInterest(xrdndn::SYS_CALL_FSTAT_PREFIX_URI);
 
     NDN_LOG_INFO("Request fstat for file: " << m_path << " with Interest: "
                                             << fstatInterest);
 
-    FutureType future = m_pipeline->insert(fstatInterest);
-    if (!future.valid()) {
-        NDN_LOG_ERROR("Received invalid future for fstat request");
-        return -ECONNABORTED;
-    }
-
-    try {
-        future.wait();
-    } catch (const std::exception &e) {
-        NDN_LOG_ERROR("Catch exception: "
-                      << e.what()
-                      << " while waiting for future on fstat request");
-        return -ECONNABORTED;
-    }
-
-    DataTypeTuple fstatResult = future.get();
-    int retFstat =
-        validateData(std::get<0>(fstatResult), std::get<1>(fstatResult),
-                     std::get<2>(fstatResult));
+    ndn::Block content;
+    int retFstat = this->fetchOne(fstatInterest, content);
 
     if (retFstat == XRDNDN_ESUCCESS) {
-        memcpy((uint8_t *)buff, std::get<2>(fstatResult).getContent().value(),
-               sizeof(struct stat));
+        memcpy((uint8_t *)buff, content.value(), sizeof(struct stat));
+        setFileSize(buff->st_size);
     }
 
     NDN_LOG_INFO("Fstat file: " << m_path << " with error code: " << retFstat);
@@ -226,80 +375,596 @@ int Consumer::Fstat(struct stat *buff) {
 /*****************************************************************************/
 /*                                  R e a d                                  */
 /*****************************************************************************/
+Consumer::ReadRequest::ReadRequest(Consumer &consumer, void *buff,
+                                   off_t offset, size_t blen,
+                                   Callback callback)
+    : consumer(consumer), buff(buff), offset(offset), blen(blen),
+      sequential(false), nextMissing(0), nextSegmentNo(0), nBytes(0),
+      errcode(XRDNDN_ESUCCESS), nPending(1), callback(std::move(callback)),
+      retried(false), done(1) {
+    firstSegmentNo = offset / XRDNDN_MAX_NDN_PACKET_SIZE;
+    lastSegmentNo =
+        ceil((offset + blen) / static_cast<double>(XRDNDN_MAX_NDN_PACKET_SIZE));
+
+    // Nothing is requested past the end of file, thus a read starting there
+    // returns 0 right away
+    lastSegmentNo = std::max(
+        firstSegmentNo, std::min(lastSegmentNo, consumer.getSegmentCount()));
+}
+
+void Consumer::ReadRequest::onFinalBlock(uint64_t finalSegmentNo) {
+    consumer.onFinalBlock(finalSegmentNo);
+}
+
+bool Consumer::ReadRequest::isEdgeSegment(uint64_t segmentNo) const {
+    return (segmentNo == firstSegmentNo &&
+            offset % XRDNDN_MAX_NDN_PACKET_SIZE != 0) ||
+           (segmentNo == lastSegmentNo - 1 &&
+            (offset + blen) % XRDNDN_MAX_NDN_PACKET_SIZE != 0);
+}
+
+void Consumer::ReadRequest::put(uint64_t segmentNo,
+                                const ndn::Block &content) {
+    nBytes += consumer.putSegment(buff, offset, blen, segmentNo, content);
+
+    if (isEdgeSegment(segmentNo))
+        consumer.storeEdgeSegment(segmentNo, content);
+}
+
+void Consumer::ReadRequest::fail(int errcode) {
+    int expected = XRDNDN_ESUCCESS;
+    this->errcode.compare_exchange_strong(expected, errcode);
+}
+
+void Consumer::ReadRequest::addPending() { ++nPending; }
+
+void Consumer::ReadRequest::releasePending() {
+    if (--nPending > 0)
+        return;
+
+    NDN_LOG_TRACE("Received read Data for "
+                  << blen << " bytes @" << offset << " from file: "
+                  << consumer.m_path << " with ret: " << getResult());
+
+    if (!callback) {
+        // Last touch of a synchronous request, the reader returns after this
+        done.countDown();
+        return;
+    }
+
+    if (getResult() != -ESTALE || retried) {
+        this->finish();
+        return;
+    }
+
+    // Done once more if the Producer no longer knows the file handle
+    retried = true;
+    consumer.renewFileHandleAsync(readPrefix, [this](bool renewed) {
+        if (!renewed) {
+            this->finish();
+            return;
+        }
+
+        nBytes = 0;
+        errcode = XRDNDN_ESUCCESS;
+        nPending = 1;
+        consumer.submitRead(*this);
+    });
+}
+
+void Consumer::ReadRequest::finish() {
+    auto onDone = std::move(callback);
+    auto result = getResult();
+    delete this;
+    onDone(result);
+}
+
+ssize_t Consumer::ReadRequest::getResult() const {
+    if (errcode != XRDNDN_ESUCCESS)
+        return errcode;
+    return nBytes;
+}
+
+void Consumer::ReadRequest::onComplete(uint64_t segmentNo, int errcode,
+                                       const ndn::Block &content) {
+    if (errcode != XRDNDN_ESUCCESS) {
+        NDN_LOG_ERROR("Error occured while reading segment: "
+                      << segmentNo << " from file: " << consumer.m_path);
+        this->fail(errcode);
+    } else {
+        nBytes += consumer.putSegment(buff, offset, blen, segmentNo, content);
+
+        if (isEdgeSegment(segmentNo)) {
+            boost::unique_lock<boost::mutex> lock(consumer.m_mtxSegments);
+            // Data read by a handle renewed since may be of an old version
+            if (readPrefix == std::atomic_load(&consumer.m_readPrefix))
+                consumer.storeEdgeSegment(segmentNo, content);
+        }
+    }
+
+    this->releasePending();
+}
+
 ssize_t Consumer::Read(void *buff, off_t offset, size_t blen) {
-    NDN_LOG_TRACE("Reading " << blen << " bytes @" << offset
+    // Done once more if the Producer no longer knows the file handle
+    for (bool retry = true;; retry = false) {
+        ReadRequest request(*this, buff, offset, blen, nullptr);
+        this->submitRead(request);
+
+        // Completions reference the request, so it must not go out of scope
+        // before all of them are received, even on error
+        request.done.wait();
+        auto ret = request.getResult();
+        if (!retry || ret != -ESTALE || !renewFileHandle(request.readPrefix))
+            return ret;
+    }
+}
+
+void Consumer::ReadAsync(void *buff, off_t offset, size_t blen,
+                         std::function<void(ssize_t)> callback) {
+    auto request =
+        new ReadRequest(*this, buff, offset, blen, std::move(callback));
+    this->submitRead(*request);
+}
+
+void Consumer::submitRead(ReadRequest &request) {
+    NDN_LOG_TRACE("Reading " << request.blen << " bytes @" << request.offset
                              << " from file: " << m_path);
 
-    off_t firstSegmentIdx = offset / XRDNDN_MAX_NDN_PACKET_SIZE;
-    off_t lastSegmentIdx =
-        ceil((offset + blen) / static_cast<double>(XRDNDN_MAX_NDN_PACKET_SIZE));
+    request.readPrefix = std::atomic_load(&m_readPrefix);
+    request.readSpec = getReadSpec(request.readPrefix);
+    {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        request.sequential =
+            this->isSequential(request.offset, request.firstSegmentNo);
+        if (!request.sequential)
+            this->dropReadahead();
+        m_nextOffset = request.offset + request.blen;
+    }
 
-    std::vector<FutureType> futures;
-    for (auto i = firstSegmentIdx; i < lastSegmentIdx; ++i) {
-        auto future = m_pipeline->insert(
-            getInterest(xrdndn::SYS_CALL_READ_PREFIX_URI, i));
+    request.missing.clear();
+    request.missing.reserve(m_options.pipelineSize);
+    request.nextMissing = 0;
+    request.nextSegmentNo = request.firstSegmentNo;
+    this->continueRead(request);
+}
 
-        if (future.valid()) {
-            futures.push_back(std::move(future));
-        } else {
-            NDN_LOG_ERROR("Received invalid future for read request");
-            return -ECONNABORTED;
+void Consumer::continueRead(ReadRequest &request) {
+    bool async = static_cast<bool>(request.callback);
+    auto offset = request.offset;
+    auto blen = request.blen;
+
+    // The request is streamed one window at a time: segments are looked up
+    // and requested only as Pipeline slots free up, so the bookkeeping of a
+    // huge read is bounded by the window size instead of the read size
+    for (;;) {
+        for (; request.nextMissing < request.missing.size();
+             ++request.nextMissing) {
+            auto i = request.missing[request.nextMissing];
+            request.addPending();
+            if (async ? m_pipeline->tryInsert(request.readSpec, i, &request)
+                      : m_pipeline->insert(request.readSpec, i, &request))
+                continue;
+
+            // The submitter's hold keeps the request alive
+            request.releasePending();
+            if (async && m_pipeline->waitForSlot([this, &request]() {
+                    this->continueRead(request);
+                }))
+                return;
+
+            NDN_LOG_ERROR("Pipeline refused read request for segment: " << i);
+            request.fail(-ECONNABORTED);
+            break;
+        }
+
+        // No point in requesting the rest of a read that already failed
+        if (request.errcode != XRDNDN_ESUCCESS ||
+            request.nextSegmentNo >= request.lastSegmentNo)
+            break;
+
+        auto batchIdx = request.nextSegmentNo;
+        auto batchEndIdx = std::min<uint64_t>(
+            request.lastSegmentNo, batchIdx + m_options.pipelineSize);
+        request.nextSegmentNo = batchEndIdx;
+        request.missing.clear();
+        request.nextMissing = 0;
+
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        for (auto i = batchIdx; i < batchEndIdx; ++i) {
+            auto edge = this->findEdgeSegment(i);
+            if (edge) {
+                request.nBytes +=
+                    this->putSegment(request.buff, offset, blen, i, *edge);
+                ++m_nEdgeSegmentsReused;
+                continue;
+            }
+
+            auto entry = this->findReadahead(i);
+            if (entry && entry->state == SegmentState::READY) {
+                if (entry->errcode != XRDNDN_ESUCCESS)
+                    request.fail(entry->errcode);
+                else
+                    request.put(i, entry->content);
+
+                *entry = ReadaheadEntry();
+                ++m_nReadaheadHits;
+                continue;
+            }
+
+            if (entry && !entry->waiter) {
+                // The segment is in flight, its Data goes to this request
+                entry->waiter = &request;
+                request.addPending();
+                ++m_nReadaheadHits;
+                continue;
+            }
+
+            request.missing.push_back(i);
         }
     }
 
-    std::map<uint64_t, const ndn::Block> dataStore;
-    for (auto it = futures.begin(); it != futures.end(); ++it) {
-        try {
-            auto readResult = it->get();
-            auto retRead =
-                validateData(std::get<0>(readResult), std::get<1>(readResult),
-                             std::get<2>(readResult));
+    if (request.sequential && m_options.readahead > 0) {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        this->prefetch(request.lastSegmentNo,
+                       request.lastSegmentNo - request.firstSegmentNo);
+    }
+
+    // The request may be finished and gone after this
+    request.releasePending();
+}
+
+/*****************************************************************************/
+/*                               P r e r e a d                               */
+/*****************************************************************************/
+void Consumer::Preread(off_t offset, size_t blen) {
+    if (m_readahead.empty() || blen == 0)
+        return;
+
+    uint64_t firstSegmentNo = offset / XRDNDN_MAX_NDN_PACKET_SIZE;
+    uint64_t endSegmentNo =
+        ceil((offset + blen) / static_cast<double>(XRDNDN_MAX_NDN_PACKET_SIZE));
+    endSegmentNo = std::min(endSegmentNo, getSegmentCount());
+    endSegmentNo = std::min(endSegmentNo, firstSegmentNo + m_readahead.size());
+
+    NDN_LOG_TRACE("Preread " << blen << " bytes @" << offset
+                             << " from file: " << m_path);
+
+    boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+    for (auto i = firstSegmentNo; i < endSegmentNo; ++i) {
+        if (m_edgeSegments.find(i) != m_edgeSegments.end())
+            continue;
+
+        // The hint is the latest information about what will be read, so it
+        // may evict any prefetched segment nobody is waiting for
+        auto &entry = m_readahead[i % m_readahead.size()];
+        if ((entry.state != SegmentState::EMPTY && entry.segmentNo == i) ||
+            entry.waiter)
+            continue;
+
+        if (!this->requestReadahead(entry, i))
+            break;
+    }
+}
+
+/*****************************************************************************/
+/*                                 R e a d V                                 */
+/*****************************************************************************/
+Consumer::VectorReadRequest::VectorReadRequest(Consumer &consumer,
+                                               const ReadChunk *chunks,
+                                               size_t nChunks)
+    : consumer(consumer), chunks(chunks), nBytes(0),
+      errcode(XRDNDN_ESUCCESS) {
+    // Chunks past the end of file are not requested and make the read fail
+    // with -ESPIPE
+    auto nSegments = consumer.getSegmentCount();
+    for (size_t i = 0; i < nChunks; ++i) {
+        if (chunks[i].blen == 0)
+            continue;
+
+        off_t end = chunks[i].offset + chunks[i].blen;
+        uint64_t first = chunks[i].offset / XRDNDN_MAX_NDN_PACKET_SIZE;
+        uint64_t last = (end - 1) / XRDNDN_MAX_NDN_PACKET_SIZE;
+        if (first >= nSegments)
+            continue;
+        last = std::min(last, nSegments - 1);
+        for (auto segmentNo = first; segmentNo <= last; ++segmentNo)
+            segmentChunks.emplace_back(segmentNo, i);
+    }
+
+    std::sort(segmentChunks.begin(), segmentChunks.end());
+}
+
+void Consumer::VectorReadRequest::put(uint64_t segmentNo,
+                                      const ndn::Block &content) {
+    auto it = std::lower_bound(segmentChunks.begin(), segmentChunks.end(),
+                               std::make_pair(segmentNo, size_t(0)));
+
+    for (; it != segmentChunks.end() && it->first == segmentNo; ++it) {
+        auto &chunk = chunks[it->second];
+        nBytes += consumer.putSegment(chunk.buff, chunk.offset, chunk.blen,
+                                      segmentNo, content);
+    }
+}
+
+void Consumer::VectorReadRequest::onFinalBlock(uint64_t finalSegmentNo) {
+    consumer.onFinalBlock(finalSegmentNo);
+}
+
+void Consumer::VectorReadRequest::fail(int errcode) {
+    int expected = XRDNDN_ESUCCESS;
+    this->errcode.compare_exchange_strong(expected, errcode);
+}
+
+void Consumer::VectorReadRequest::onComplete(uint64_t segmentNo, int errcode,
+                                             const ndn::Block &content) {
+    if (errcode != XRDNDN_ESUCCESS) {
+        NDN_LOG_ERROR("Error occured while reading segment: "
+                      << segmentNo << " from file: " << consumer.m_path);
+        this->fail(errcode);
+    } else {
+        this->put(segmentNo, content);
+    }
+
+    // Last touch of the request, the reader may return right after this
+    latch.countDown();
+}
+
+ssize_t Consumer::ReadV(const ReadChunk *chunks, size_t nChunks) {
+    NDN_LOG_TRACE("Reading " << nChunks << " chunks from file: " << m_path);
+
+    // Done once more if the Producer no longer knows the file handle
+    for (bool retry = true;; retry = false) {
+        VectorReadRequest request(*this, chunks, nChunks);
+        auto ret = this->submitReadV(request, nChunks);
+        if (!retry || ret != -ESTALE || !renewFileHandle(request.readPrefix))
+            return ret;
+    }
+}
+
+ssize_t Consumer::submitReadV(VectorReadRequest &request, size_t nChunks) {
+    auto chunks = request.chunks;
+
+    request.readPrefix = std::atomic_load(&m_readPrefix);
+
+    size_t nBytesExpected = 0;
+    for (size_t i = 0; i < nChunks; ++i)
+        nBytesExpected += chunks[i].blen;
+
+    // Segments already available are taken from the edge and readahead
+    // stores. Scattered reads do not drive the sequential readahead
+    std::vector<uint64_t> missing;
+    {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        for (size_t j = 0; j < request.segmentChunks.size(); ++j) {
+            auto i = request.segmentChunks[j].first;
+            if (j > 0 && request.segmentChunks[j - 1].first == i)
+                continue;
+
+            auto edge = this->findEdgeSegment(i);
+            if (edge) {
+                request.put(i, *edge);
+                ++m_nEdgeSegmentsReused;
+                continue;
+            }
+
+            auto entry = this->findReadahead(i);
+            if (entry && entry->state == SegmentState::READY) {
+                if (entry->errcode != XRDNDN_ESUCCESS)
+                    request.fail(entry->errcode);
+                else
+                    request.put(i, entry->content);
+
+                *entry = ReadaheadEntry();
+                ++m_nReadaheadHits;
+                continue;
+            }
 
-            if (retRead != XRDNDN_ESUCCESS) {
-                return retRead;
+            if (entry && !entry->waiter) {
+                entry->waiter = &request;
+                request.latch.add();
+                ++m_nReadaheadHits;
+                continue;
             }
-            dataStore.insert(std::pair<uint64_t, const Block>(
-                xrdndn::Utils::getSegmentNo(std::get<2>(readResult).getName()),
-                std::get<2>(readResult).getContent()));
-        } catch (const std::exception &e) {
-            NDN_LOG_ERROR("Catch exception: "
-                          << e.what()
-                          << " while waiting for future on read request");
-            return -ECONNABORTED;
+
+            missing.push_back(i);
+        }
+    }
+
+    // All Interests are queued at once and expressed in one batch by the
+    // Face thread
+    auto readSpec = getReadSpec(request.readPrefix);
+    for (auto i : missing) {
+        request.latch.add();
+        if (!m_pipeline->insert(readSpec, i, &request)) {
+            NDN_LOG_ERROR("Pipeline refused read request for segment: " << i);
+            request.latch.countDown();
+            request.fail(-ECONNABORTED);
+            break;
         }
     }
 
-    auto retRead = this->returnData(buff, offset, blen, std::ref(dataStore));
-    NDN_LOG_TRACE("Received read Data for " << blen << " bytes @" << offset
-                                            << " from file: " << m_path
-                                            << " with ret: " << retRead);
+    request.latch.wait();
 
-    return retRead;
+    if (request.errcode != XRDNDN_ESUCCESS)
+        return request.errcode;
+
+    NDN_LOG_TRACE("Received Data for " << nChunks << " chunks from file: "
+                                       << m_path << " with ret: "
+                                       << request.nBytes);
+
+    // Same as XRootD does for vector reads: chunks must be read entirely
+    if (request.nBytes != nBytesExpected)
+        return -ESPIPE;
+
+    return request.nBytes;
 }
 
-// todo: make this better, without map and shit
-inline size_t
-Consumer::returnData(void *buff, off_t offset, size_t blen,
-                     std::map<uint64_t, const ndn::Block> &dataStore) {
-    size_t nBytes = 0;
+void Consumer::onComplete(uint64_t segmentNo, int errcode,
+                          const ndn::Block &content) {
+    FetchCompletion *waiter = nullptr;
+    {
+        boost::unique_lock<boost::mutex> lock(m_mtxSegments);
+        auto entry = this->findReadahead(segmentNo);
+        if (!entry || entry->state != SegmentState::PENDING) {
+            m_nPrefetching.countDown();
+            return;
+        }
 
-    auto putData = [&](const Block &content, size_t contentoff) {
-        auto len = std::min(content.value_size() - contentoff, blen);
-        memcpy((uint8_t *)buff + nBytes, content.value() + contentoff, len);
-        nBytes += len;
-        blen -= len;
-    };
+        if (entry->waiter) {
+            waiter = entry->waiter;
+            *entry = ReadaheadEntry();
+        } else {
+            entry->state = SegmentState::READY;
+            entry->errcode = errcode;
+            entry->content = content;
+        }
+    }
+
+    if (waiter)
+        waiter->onComplete(segmentNo, errcode, content);
 
-    auto it = dataStore.begin();
-    // Store first bytes in buffer from offset
-    putData(it->second, offset % XRDNDN_MAX_NDN_PACKET_SIZE);
-    it = dataStore.erase(it);
+    // Last touch of the Consumer, it may be destroyed after this
+    m_nPrefetching.countDown();
+}
+
+void Consumer::onFinalBlock(uint64_t finalSegmentNo) {
+    // The file size is more precise: an empty file has no segments, yet the
+    // Producer answers segment 0 with an empty one
+    uint64_t unknown = std::numeric_limits<uint64_t>::max();
+    m_nSegments.compare_exchange_strong(unknown, finalSegmentNo + 1);
+}
 
-    // Store rest of bytes until end
-    for (; it != dataStore.end(); it = dataStore.erase(it)) {
-        putData(it->second, 0);
+void Consumer::setFileSize(off_t fileSize) {
+    m_nSegments =
+        ceil(fileSize / static_cast<double>(XRDNDN_MAX_NDN_PACKET_SIZE));
+}
+
+uint64_t Consumer::getSegmentCount() const { return m_nSegments; }
+
+size_t Consumer::putSegment(void *buff, off_t offset, size_t blen,
+                            uint64_t segmentNo, const ndn::Block &content) {
+    off_t segmentOffset = segmentNo * XRDNDN_MAX_NDN_PACKET_SIZE;
+    size_t contentOffset = offset > segmentOffset ? offset - segmentOffset : 0;
+    size_t buffOffset = segmentOffset > offset ? segmentOffset - offset : 0;
+
+    if (contentOffset >= content.value_size() || buffOffset >= blen)
+        return 0;
+
+    auto len =
+        std::min(content.value_size() - contentOffset, blen - buffOffset);
+    memcpy((uint8_t *)buff + buffOffset, content.value() + contentOffset, len);
+    return len;
+}
+
+void Consumer::storeEdgeSegment(uint64_t segmentNo, const ndn::Block &content) {
+    auto it = m_edgeSegments.find(segmentNo);
+    if (it != m_edgeSegments.end()) {
+        it->second.content = content;
+        m_edgeSegmentsLru.splice(m_edgeSegmentsLru.end(), m_edgeSegmentsLru,
+                                 it->second.lru);
+        return;
     }
 
-    return nBytes;
+    m_edgeSegmentsLru.push_back(segmentNo);
+    m_edgeSegments.emplace(
+        segmentNo, EdgeSegment{content, std::prev(m_edgeSegmentsLru.end())});
+
+    while (m_edgeSegments.size() > MAX_EDGE_SEGMENTS) {
+        m_edgeSegments.erase(m_edgeSegmentsLru.front());
+        m_edgeSegmentsLru.pop_front();
+    }
+}
+
+const ndn::Block *Consumer::findEdgeSegment(uint64_t segmentNo) {
+    auto it = m_edgeSegments.find(segmentNo);
+    if (it == m_edgeSegments.end())
+        return nullptr;
+
+    m_edgeSegmentsLru.splice(m_edgeSegmentsLru.end(), m_edgeSegmentsLru,
+                             it->second.lru);
+    return &it->second.content;
+}
+
+void Consumer::clearEdgeSegments() {
+    m_edgeSegments.clear();
+    m_edgeSegmentsLru.clear();
 }
+
+Consumer::ReadaheadEntry *Consumer::findReadahead(uint64_t segmentNo) {
+    if (m_readahead.empty())
+        return nullptr;
+
+    auto &entry = m_readahead[segmentNo % m_readahead.size()];
+    if (entry.state == SegmentState::EMPTY || entry.segmentNo != segmentNo)
+        return nullptr;
+
+    return &entry;
+}
+
+bool Consumer::isSequential(off_t offset, uint64_t firstSegmentNo) {
+    if (offset == m_nextOffset || this->findReadahead(firstSegmentNo))
+        return true;
+
+    return firstSegmentNo < m_readaheadNext &&
+           firstSegmentNo + m_readahead.size() >= m_readaheadNext;
+}
+
+void Consumer::prefetch(uint64_t segmentNo, size_t nSegments) {
+    size_t depth = std::min(
+        std::max(m_pipeline->getBdpSegments(), nSegments), m_options.readahead);
+
+    uint64_t endSegmentNo = std::min(segmentNo + depth, getSegmentCount());
+
+    for (auto i = std::max(segmentNo, m_readaheadNext); i < endSegmentNo; ++i) {
+        auto &entry = m_readahead[i % m_readahead.size()];
+        if (entry.state != SegmentState::EMPTY && entry.segmentNo == i) {
+            // Already requested, e.g. by a preread hint
+            m_readaheadNext = i + 1;
+            continue;
+        }
+
+        // Segments left behind by the stream are evicted only when their entry
+        // is needed, since concurrent readers of the same stream may still use
+        // them. Data of evicted Interests still in flight is discarded
+        if (entry.state != SegmentState::EMPTY &&
+            (entry.waiter || entry.segmentNo >= segmentNo))
+            break;
+
+        if (!this->requestReadahead(entry, i))
+            break;
+        m_readaheadNext = i + 1;
+    }
+
+    NDN_LOG_TRACE("Readahead depth: " << depth << " segments. Prefetched until "
+                                      << m_readaheadNext
+                                      << " for file: " << m_path);
+}
+
+bool Consumer::requestReadahead(ReadaheadEntry &entry, uint64_t segmentNo) {
+    entry = ReadaheadEntry();
+    entry.segmentNo = segmentNo;
+    entry.state = SegmentState::PENDING;
+
+    // Counted before insertion, as the completion may come first
+    m_nPrefetching.add();
+    auto readPrefix = std::atomic_load(&m_readPrefix);
+    if (!m_pipeline->tryInsert(getReadSpec(readPrefix), segmentNo, this)) {
+        m_nPrefetching.countDown();
+        entry.state = SegmentState::EMPTY;
+        return false;
+    }
+
+    ++m_nSegmentsPrefetched;
+    return true;
+}
+
+void Consumer::dropReadahead() {
+    for (auto &entry : m_readahead) {
+        if (!entry.waiter)
+            entry = ReadaheadEntry();
+    }
+    m_readaheadNext = 0;
+}
+
 } // namespace xrdndnconsumer
\ No newline at end of file
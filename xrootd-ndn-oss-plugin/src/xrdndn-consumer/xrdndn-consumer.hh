@@ -22,8 +22,10 @@
 #define XRDNDN_CONSUMER_HH
 
 #include <atomic>
+#include <list>
 #include <map>
 #include <sys/stat.h>
+#include <vector>
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/security/v2/validation-error.hpp>
@@ -35,7 +37,9 @@
 
 #include "../common/xrdndn-namespace.hh"
 #include "xrdndn-consumer-options.hh"
+#include "xrdndn-countdown-latch.hh"
 #include "xrdndn-pipeline.hh"
+#include "xrdndn-session.hh"
 
 namespace xrdndnconsumer {
 /**
@@ -44,36 +48,247 @@ namespace xrdndnconsumer {
  *
  * It translates file system calls into Interest packets and expresess them over
  * the NDN network. It takes care of each individual Interest and will return
- * specific Data for each system call
+ * specific Data for each system call. Prefetched segments are delivered to the
+ * Consumer itself, which keeps them in the readahead store
  *
  */
 class Consumer : public std::enable_shared_from_this<Consumer>,
+                 private FetchCompletion,
                  private boost::noncopyable {
-    using DataTypeTuple = std::tuple<int, ndn::Interest, ndn::Data>;
-    using FutureType = std::future<DataTypeTuple>;
+  public:
+    /**
+     * @brief One chunk of a vector read
+     *
+     */
+    struct ReadChunk {
+        void *buff;
+        off_t offset;
+        size_t blen;
+    };
+
+  private:
+    /**
+     * @brief Maximum no. of partially consumed edge segments kept per file
+     *
+     */
+    static const size_t MAX_EDGE_SEGMENTS;
+
+    /**
+     * @brief State of a readahead store entry
+     *
+     */
+    enum class SegmentState { EMPTY, PENDING, READY };
+
+    /**
+     * @brief Readahead store entry. The store is a ring of entries allocated
+     * once per file and indexed by segment number
+     *
+     */
+    struct ReadaheadEntry {
+        uint64_t segmentNo = 0;
+        SegmentState state = SegmentState::EMPTY;
+        int errcode = XRDNDN_ESUCCESS;
+        ndn::Block content;
+        // Read request waiting for the pending segment
+        FetchCompletion *waiter = nullptr;
+    };
+
+    /**
+     * @brief Completion of a single Interest (e.g. open or fstat request)
+     *
+     */
+    class SingleRequest : public FetchCompletion {
+      public:
+        SingleRequest() : errcode(XRDNDN_ESUCCESS), latch(1) {}
+
+        void onComplete(uint64_t segmentNo, int errcode,
+                        const ndn::Block &content) override;
+
+        int errcode;
+        ndn::Block content;
+        CountdownLatch latch;
+    };
+
+    /**
+     * @brief Combined open done again to renew a stale file handle, allocated
+     * once per renewal. It deletes itself before calling callback
+     *
+     */
+    class RenewRequest : public FetchCompletion {
+      public:
+        using Callback = std::function<void(bool)>;
+
+        RenewRequest(Consumer &consumer, Callback callback)
+            : consumer(consumer), callback(std::move(callback)) {}
+
+        void onComplete(uint64_t segmentNo, int errcode,
+                        const ndn::Block &content) override;
+
+        Consumer &consumer;
+        InterestSpec spec;
+        Callback callback;
+    };
+
+    /**
+     * @brief Read request of Consumer::Read, living on the caller's stack, or
+     * of Consumer::ReadAsync, allocated once per call. Every segment is copied
+     * straight into its place in the buffer as soon as its Data is received.
+     * The request is finished when the last pending segment is received
+     *
+     */
+    class ReadRequest : public FetchCompletion {
+      public:
+        using Callback = std::function<void(ssize_t)>;
+
+        /**
+         * @brief Construct a new Read Request object
+         *
+         * @param callback If empty, the request is synchronous and the caller
+         * waits on done. Else the request is allocated on heap and deletes
+         * itself before calling callback with the result
+         */
+        ReadRequest(Consumer &consumer, void *buff, off_t offset, size_t blen,
+                    Callback callback);
+
+        void onComplete(uint64_t segmentNo, int errcode,
+                        const ndn::Block &content) override;
+
+        void onFinalBlock(uint64_t finalSegmentNo) override;
+
+        /**
+         * @brief Copy a segment into the buffer and keep it if it is an edge
+         * segment. The segments mutex must be held by the caller
+         *
+         */
+        void put(uint64_t segmentNo, const ndn::Block &content);
+
+        /**
+         * @brief Record the first error of the request
+         *
+         */
+        void fail(int errcode);
+
+        /**
+         * @brief Wait for one more segment
+         *
+         */
+        void addPending();
+
+        /**
+         * @brief One segment less to wait for. The last one finishes the
+         * request, which must not be touched afterwards. An asynchronous
+         * request that found the file handle stale is done once more instead
+         *
+         */
+        void releasePending();
+
+        /**
+         * @brief Delete an asynchronous request and call its callback
+         *
+         */
+        void finish();
+
+        bool isEdgeSegment(uint64_t segmentNo) const;
+
+        ssize_t getResult() const;
+
+        Consumer &consumer;
+        void *buff;
+        off_t offset;
+        size_t blen;
+        uint64_t firstSegmentNo;
+        uint64_t lastSegmentNo;
+        // Read Name prefix used for all segments of the request
+        std::shared_ptr<const ndn::Name> readPrefix;
+        InterestSpec readSpec;
+        bool sequential;
+
+        // Segments of the current batch that are not buffered, and the next
+        // one to request. An asynchronous request waiting for a place in the
+        // window resumes from there
+        std::vector<uint64_t> missing;
+        size_t nextMissing;
+        // First segment of the next batch
+        uint64_t nextSegmentNo;
+
+        std::atomic<size_t> nBytes;
+        std::atomic<int> errcode;
+
+        // Held by the submitter until all segments are requested
+        std::atomic<size_t> nPending;
+        Callback callback;
+        bool retried;
+        CountdownLatch done;
+    };
+
+    /**
+     * @brief Vector read request. The union of the segments needed by all
+     * chunks is fetched once and each segment is copied into every chunk it
+     * overlaps as soon as its Data is received
+     *
+     */
+    class VectorReadRequest : public FetchCompletion {
+      public:
+        VectorReadRequest(Consumer &consumer, const ReadChunk *chunks,
+                          size_t nChunks);
+
+        void onComplete(uint64_t segmentNo, int errcode,
+                        const ndn::Block &content) override;
+
+        void onFinalBlock(uint64_t finalSegmentNo) override;
+
+        /**
+         * @brief Copy a segment into all the chunks it overlaps
+         *
+         */
+        void put(uint64_t segmentNo, const ndn::Block &content);
+
+        /**
+         * @brief Record the first error of the request
+         *
+         */
+        void fail(int errcode);
+
+        Consumer &consumer;
+        const ReadChunk *chunks;
+        // (segment number, chunk index) pairs, sorted by segment number
+        std::vector<std::pair<uint64_t, size_t>> segmentChunks;
+        // Read Name prefix used for all segments of the request
+        std::shared_ptr<const ndn::Name> readPrefix;
+
+        std::atomic<size_t> nBytes;
+        std::atomic<int> errcode;
+        CountdownLatch latch;
+    };
 
   public:
     /**
      * @brief Returns a pointer to a Consumer object instance.
      *
      * @param opts Consumer instance options
+     * @param session Session shared with other Consumers. If empty, the
+     * Consumer creates its own session
      * @return std::shared_ptr<Consumer> If the Consumer is not able to connect
      * to local forwarder it will return nullptr, else the Consumer instance
      * will be returned
      */
 
     static std::shared_ptr<Consumer>
-    getXrdNdnConsumerInstance(const Options &opts = Options());
+    getXrdNdnConsumerInstance(const Options &opts = Options(),
+                              std::shared_ptr<Session> session = nullptr);
 
     /**
      * @brief Construct a new Consumer object
      *
      * @param opts Consumer instance options
+     * @param session Session shared with other Consumers. If empty, the
+     * Consumer creates its own session
      */
-    Consumer(const Options &opts);
+    Consumer(const Options &opts, std::shared_ptr<Session> session = nullptr);
 
     /**
-     * @brief Destroy the Consumer object
+     * @brief Destroy the Consumer object. With a shared session, it waits for
+     * its outstanding prefetched segments
      *
      */
     ~Consumer();
@@ -118,6 +333,48 @@ class Consumer : public std::enable_shared_from_this<Consumer>,
      */
     ssize_t Read(void *buff, off_t offset, size_t blen);
 
+    /**
+     * @brief Read blen bytes from file over NDN without waiting for the Data.
+     * The caller never blocks: if the Pipeline window is full, the rest of the
+     * segments are requested from the Face thread as places free up
+     *
+     * @param buff The address where data will be stored. It must stay valid
+     * until callback is called
+     * @param offset Offset in file were the read will begin
+     * @param blen The number of bytes to be read by Producer
+     * @param callback Called once with the actual number of bytes read or
+     * -errno. It is called from the Face thread, or from the caller's thread
+     * if all segments are already available. The Consumer must not be closed
+     * before all callbacks are called. Like Read, it is done once more if the
+     * file handle is stale, after the handle is renewed without blocking
+     */
+    void ReadAsync(void *buff, off_t offset, size_t blen,
+                   std::function<void(ssize_t)> callback);
+
+    /**
+     * @brief Start fetching a range of the file in background, without
+     * waiting for it. The segments are kept in the readahead store, where a
+     * later Read will find them. Only free Pipeline slots are used and at most
+     * as many segments as the readahead store holds. Nothing is done if
+     * readahead is disabled
+     *
+     * @param offset Offset in file were the future read will begin
+     * @param blen The number of bytes that will be read
+     */
+    void Preread(off_t offset, size_t blen);
+
+    /**
+     * @brief Read many chunks from file over NDN. The segments needed by all
+     * chunks are deduplicated and requested at once, instead of one round
+     * trip per chunk
+     *
+     * @param chunks The chunks
+     * @param nChunks The number of chunks
+     * @return ssize_t On success the total number of bytes read. -ESPIPE if a
+     * chunk goes beyond the end of file, else -errno
+     */
+    ssize_t ReadV(const ReadChunk *chunks, size_t nChunks);
+
   private:
     /**
      * @brief Set the Log Level object
@@ -126,63 +383,312 @@ class Consumer : public std::enable_shared_from_this<Consumer>,
     void setLogLevel();
 
     /**
-     * @brief Process Interests
+     * @brief Completion of prefetched segments. Stores the segment in the
+     * readahead store or hands it over to the read request waiting for it
+     *
+     */
+    void onComplete(uint64_t segmentNo, int errcode,
+                    const ndn::Block &content) override;
+
+    /**
+     * @brief Learn the number of segments of the file from the FinalBlockId
+     * of read Data, unless the file size is already known
+     *
+     */
+    void onFinalBlock(uint64_t finalSegmentNo) override;
+
+    /**
+     * @brief Set the number of segments of the file from its size
+     *
+     */
+    void setFileSize(off_t fileSize);
+
+    /**
+     * @brief Get the number of segments of the file. Segments are never
+     * requested beyond it
+     *
+     * @return uint64_t The number of segments. The maximum value if neither
+     * the file size nor the last segment number is known yet
+     */
+    uint64_t getSegmentCount() const;
+
+    /**
+     * @brief Express one Interest and wait for its Data
+     *
+     * @param interest The Interest
+     * @param content On success the Content of Data for Interest
+     * @return int 0 on success or -errno
+     */
+    int fetchOne(const ndn::Interest &interest, ndn::Block &content);
+
+    /**
+     * @brief Open the file with a single combined Interest. Besides the open
+     * result, the Data carries the file stat, version and handle and, for
+     * small files, the first segment. The stat answers later Fstat calls
+     * without a round trip and the segment is kept as an edge segment. Read
+     * Names carry the handle or the version, so their Data never changes and
+     * can be taken from any cache
+     *
+     * @return int The return value of open POSIX system call on the Producer
+     * side. 0 (success) / -errno (error)
+     */
+    int openStat();
+
+    /**
+     * @brief Describe the combined open Interest of the file
+     *
+     */
+    InterestSpec getOpenStatSpec();
+
+    /**
+     * @brief Take the stat, first segment, version and handle out of the
+     * combined open Data and publish the new read prefix
      *
-     * @param keepThread Keep thread in a blocked state (in event processing),
-     * even when there are no outstanding events (e.g., no Interest/Data is
-     * expected)
+     * @param retOpen The result of fetching the Data
+     * @param content The Content of the Data
+     * @return int 0 (success) / -errno (error)
      */
-    void processEvents(bool keepThread = true);
+    int applyOpenStat(int retOpen, ndn::Block &content);
 
     /**
-     * @brief Create Interest packet
+     * @brief Create Interest packet for a system call on the opened file
      *
      * @param prefix ndn::Name prefix of Interest Name
-     * @param segmentNo Segment number of Interest packet
      * @return const ndn::Interest The resulting Interest packet
      */
-    const ndn::Interest getInterest(ndn::Name prefix, uint64_t segmentNo = 0);
+    const ndn::Interest getInterest(const ndn::Name &prefix);
+
+    /**
+     * @brief Open the file again to replace a file handle the Producer no
+     * longer knows, e.g. after a restart, or a file version that changed.
+     * Falls back to the file path if no new handle or version is returned.
+     * Segments prefetched with the stale read prefix are dropped
+     *
+     * @param stale The read Name prefix that failed
+     * @return true The read prefix has been replaced and the read can be done
+     * again
+     * @return false The read prefix is the file path
+     */
+    bool renewFileHandle(const std::shared_ptr<const ndn::Name> &stale);
+
+    /**
+     * @brief Same as renewFileHandle, without blocking the caller. The reads
+     * use the file path until the new handle is received
+     *
+     * @param stale The read Name prefix that failed
+     * @param callback Called once with the result of renewFileHandle, from
+     * the Face thread or from the caller's thread if nothing had to be fetched
+     */
+    void renewFileHandleAsync(const std::shared_ptr<const ndn::Name> &stale,
+                              RenewRequest::Callback callback);
+
+    /**
+     * @brief Express the combined open of a renewal, or wait for a place in
+     * the Pipeline window from the Face thread
+     *
+     */
+    void requestRenew(RenewRequest &request);
+
+    /**
+     * @brief Describe the Interests for segments of the opened file. The
+     * DataFetcher appends the segment number to the read prefix of the file,
+     * so the prefix is shared and no Name is built per segment
+     *
+     * @param prefix The read Name prefix: the file handle, the versioned or
+     * the plain file path. Only the latter requires fresh Data
+     * @return InterestSpec The spec of the read Interests
+     */
+    InterestSpec getReadSpec(const std::shared_ptr<const ndn::Name> &prefix);
+
+    /**
+     * @brief Create Interest packet with the Consumer's Interest options
+     *
+     * @param name Interest Name
+     * @param mustBeFresh Cached Data past its freshness period must not be
+     * returned
+     * @return const ndn::Interest The resulting Interest packet
+     */
+    const ndn::Interest getInterestForName(const ndn::Name &name,
+                                           bool mustBeFresh = true);
+
+    /**
+     * @brief Start a read with the current read prefix and request its
+     * segments
+     *
+     * @param request The read request, holding one pending reference for the
+     * submitter
+     */
+    void submitRead(ReadRequest &request);
+
+    /**
+     * @brief Request the segments of a read from the edge store, the readahead
+     * store or the Pipeline, then drop the submitter's hold on the request.
+     * Segments are requested one Pipeline window at a time, so the state kept
+     * for a read does not grow with its size. While the window is full, a
+     * synchronous read blocks and an asynchronous one returns and is resumed
+     * from the Face thread, still holding the submitter's reference
+     *
+     * @param request The read request
+     */
+    void continueRead(ReadRequest &request);
 
     /**
-     * @brief If errcode is success 0, means Data was acquired for Interest.
-     * Validates Data. In case of success it returns errorcode set by Producer
+     * @brief Request the segments of a vector read from the edge store, the
+     * readahead store or the Pipeline and wait for all of them
      *
-     * @param errcode The result of fetching Data set by DataFetcher
-     * @param interest The Interest packet
-     * @param data Data for the Interest packet. If errcode is not 0, this is
-     * empty
-     * @return int If errcode is not 0 (success), it returns the errcode (the
-     * results of expressing Interest by DataFetcher). -1 If Data is not valid.
-     * The errorcode set by Producer for the specific Interest operation
+     * @param request The vector read request
+     * @param nChunks The number of chunks
+     * @return ssize_t On success the total number of bytes read. -ESPIPE if a
+     * chunk goes beyond the end of file, else -errno
      */
-    int validateData(const int errcode, const ndn::Interest &interest,
-                     const ndn::Data &data);
+    ssize_t submitReadV(VectorReadRequest &request, size_t nChunks);
 
     /**
-     * @brief Put data in the provided buffer from dataStore
+     * @brief Copy the part of a segment that overlaps the read request straight
+     * into its place in the provided buffer
      *
      * @param buff The buffer
-     * @param offset The offset in content where blen bytes were requested
+     * @param offset The offset in file where blen bytes were requested
      * @param blen The buffer size
-     * @param dataStore Ordered map of all Data received for a read request
-     * @return off_t The actual number of bytes that have been put in the buffer
+     * @param segmentNo The segment number
+     * @param content The content of the segment
+     * @return size_t The actual number of bytes that have been put in the
+     * buffer
+     */
+    size_t putSegment(void *buff, off_t offset, size_t blen,
+                      uint64_t segmentNo, const ndn::Block &content);
+
+    /**
+     * @brief Keep a partially consumed first or last segment of a read
+     * request. Read sizes rarely are a multiple of the segment size, so a
+     * contiguous read will start in the segment where the previous one ended
+     * and can take it from here instead of fetching it again. The segments
+     * mutex must be held by the caller
+     *
+     * @param segmentNo The segment number
+     * @param content The content of the segment
+     */
+    void storeEdgeSegment(uint64_t segmentNo, const ndn::Block &content);
+
+    /**
+     * @brief Look up a kept edge segment and mark it as the most recently
+     * used. The segments mutex must be held by the caller
+     *
+     * @return const ndn::Block* The content of the segment or nullptr
+     */
+    const ndn::Block *findEdgeSegment(uint64_t segmentNo);
+
+    /**
+     * @brief Drop all kept edge segments. The segments mutex must be held by
+     * the caller
+     *
      */
+    void clearEdgeSegments();
 
-    size_t returnData(void *buff, off_t offset, size_t blen,
-                      std::map<uint64_t, const ndn::Block> &dataStore);
+    /**
+     * @brief Look up a segment in the readahead store. The segments mutex must
+     * be held by the caller
+     *
+     * @param segmentNo The segment number
+     * @return ReadaheadEntry* The entry or nullptr if the segment is neither
+     * pending nor ready
+     */
+    ReadaheadEntry *findReadahead(uint64_t segmentNo);
+
+    /**
+     * @brief Check if a read request continues the sequential stream of
+     * previous requests. The segments mutex must be held by the caller
+     *
+     * @param offset Offset in file were the read will begin
+     * @param firstSegmentNo The first segment of the read request
+     * @return true The read continues where the last read ended, it falls
+     * inside the readahead window (e.g. concurrent readers of the same stream)
+     * or its first segment has been prefetched (e.g. by a preread hint)
+     * @return false The read is random
+     */
+    bool isSequential(off_t offset, uint64_t firstSegmentNo);
+
+    /**
+     * @brief Fetch segments beyond the current read request into the readahead
+     * store. The readahead depth is given by the measured bandwidth-delay
+     * product, at least the size of the current request and at most the
+     * configured maximum. Segments are inserted in Pipeline only while there
+     * are free slots, thus readahead never blocks the caller. The segments
+     * mutex must be held by the caller
+     *
+     * @param segmentNo The first segment after the current read request
+     * @param nSegments The number of segments of the current read request
+     */
+    void prefetch(uint64_t segmentNo, size_t nSegments);
+
+    /**
+     * @brief Claim a readahead store entry for a segment and request the
+     * segment through a free Pipeline slot. The segments mutex must be held by
+     * the caller
+     *
+     * @param entry The entry. Its previous content is discarded
+     * @param segmentNo The segment number
+     * @return true The segment has been requested
+     * @return false The Pipeline window is full or the Pipeline is stopped
+     */
+    bool requestReadahead(ReadaheadEntry &entry, uint64_t segmentNo);
+
+    /**
+     * @brief Drop all prefetched segments. Outstanding Interests will complete
+     * but their Data is discarded, unless a read request is already waiting
+     * for it. The segments mutex must be held by the caller
+     *
+     */
+    void dropReadahead();
 
   private:
     const Options m_options;
     ndn::time::seconds m_interestLifetime;
     std::string m_path;
+    // Read Name prefixes of the file, computed once in Open. The file handle
+    // or versioned path prefix replaces the plain path prefix atomically when
+    // it is renewed
+    std::shared_ptr<const ndn::Name> m_pathPrefix;
+    std::shared_ptr<const ndn::Name> m_readPrefix;
+    boost::mutex m_mtxFileHandle;
 
-    ndn::Face m_face;
-    ndn::security::v2::Validator &m_validator;
-
-    boost::thread faceProcessEventsThread;
+    std::shared_ptr<Session> m_session;
+    const bool m_ownsSession;
+    Pipeline *m_pipeline;
 
     std::atomic<bool> m_error;
-    std::shared_ptr<Pipeline> m_pipeline;
+    // Prefetched segments not yet completed
+    CountdownLatch m_nPrefetching;
+
+    // Guarded by the segments mutex, the stat is written again when the file
+    // handle is renewed
+    struct stat m_stat;
+    bool m_hasStat;
+    std::atomic<uint64_t> m_nSegments;
+
+    boost::mutex m_mtxSegments;
+
+    std::vector<ReadaheadEntry> m_readahead;
+    off_t m_nextOffset;
+    uint64_t m_readaheadNext;
+    uint64_t m_nSegmentsPrefetched;
+    uint64_t m_nReadaheadHits;
+
+    /**
+     * @brief Kept edge segment and its place in the LRU list
+     *
+     */
+    struct EdgeSegment {
+        ndn::Block content;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    std::map<uint64_t, EdgeSegment> m_edgeSegments;
+    // Segment numbers, least recently used first. The first segment of a file
+    // (e.g. the ROOT header) is read again and again, so it is evicted by
+    // use, not by segment number
+    std::list<uint64_t> m_edgeSegmentsLru;
+    uint64_t m_nEdgeSegmentsReused;
 };
 } // namespace xrdndnconsumer
 
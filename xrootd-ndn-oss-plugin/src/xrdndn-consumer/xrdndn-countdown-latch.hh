@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_COUNTDOWN_LATCH_HH
+#define XRDNDN_COUNTDOWN_LATCH_HH
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace xrdndnconsumer {
+/**
+ * @brief Synchronization of one request on many asynchronous tasks. The owner
+ * of the request adds one to the counter for each task it starts and waits
+ * until all of them have counted down. Used instead of one future per segment,
+ * thus it does not allocate memory
+ *
+ */
+class CountdownLatch : private boost::noncopyable {
+  public:
+    /**
+     * @brief Construct a new Countdown Latch object
+     *
+     * @param count Initial number of tasks to wait for
+     */
+    explicit CountdownLatch(size_t count = 0) : m_count(count) {}
+
+    /**
+     * @brief Increase the number of tasks to wait for
+     *
+     * @param n Number of new tasks
+     */
+    void add(size_t n = 1) {
+        boost::lock_guard<boost::mutex> lock(m_mtx);
+        m_count += n;
+    }
+
+    /**
+     * @brief Mark one task as completed. Waiters are woken up when the last
+     * task is completed
+     *
+     */
+    void countDown() {
+        boost::lock_guard<boost::mutex> lock(m_mtx);
+        if (m_count > 0 && --m_count == 0)
+            m_cv.notify_all();
+    }
+
+    /**
+     * @brief Block until all tasks are completed
+     *
+     */
+    void wait() {
+        boost::unique_lock<boost::mutex> lock(m_mtx);
+        m_cv.wait(lock, [&]() { return m_count == 0; });
+    }
+
+  private:
+    boost::mutex m_mtx;
+    boost::condition_variable m_cv;
+    size_t m_count;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_COUNTDOWN_LATCH_HH
@@ -20,6 +20,7 @@
 
 #include <cmath>
 
+#include "../common/xrdndn-namespace.hh"
 #include "xrdndn-data-fetcher.hh"
 
 using namespace ndn;
@@ -30,60 +31,185 @@ const uint8_t DataFetcher::MAX_RETRIES_TIMEOUT = 32;
 const ndn::time::milliseconds DataFetcher::MAX_CONGESTION_BACKOFF_TIME =
     ndn::time::seconds(8);
 
-std::shared_ptr<DataFetcher>
-DataFetcher::getDataFetcher(Face &face, const Interest &interest,
-                            NotifyTaskCompleteSuccess onSuccess,
-                            NotifyTaskCompleteFailure onFailure) {
-    auto dataFetcher =
-        std::make_shared<DataFetcher>(face, interest, onSuccess, onFailure);
-    return dataFetcher;
-}
-
-DataFetcher::DataFetcher(ndn::Face &face, const ndn::Interest &interest,
+DataFetcher::DataFetcher(ndn::Face &face,
+                         ndn::security::v2::Validator &validator,
+                         TimerWheel &timers,
                          NotifyTaskCompleteSuccess onSuccess,
-                         NotifyTaskCompleteFailure onFailure)
-    : m_face(face), m_scheduler(face.getIoService()), m_interest(interest),
-      m_nNacks(0), m_nCongestionRetries(0), m_nTimeouts(0), m_error(false),
-      m_stop(false) {
+                         NotifyTaskCompleteFailure onFailure,
+                         NotifyHedge onHedge,
+                         const ndn::Name &hedgeForwardingHint)
+    : m_face(face), m_validator(validator), m_timers(timers),
+      m_backoffTimer([this]() {
+          if (this->isFetching())
+              this->expressInterest(m_interest);
+      }),
+      m_hedgeTimer([this]() { this->expressHedge(); }),
+      m_appendSegment(false), m_segmentNo(0),
+      m_completion(nullptr), m_nNacks(0), m_nCongestionRetries(0),
+      m_nTimeouts(0), m_error(false), m_stop(true), m_hedged(false),
+      m_hedgeWon(false), m_hedgePending(false),
+      m_primaryErrcode(XRDNDN_ESUCCESS) {
     m_onSuccess = std::move(onSuccess);
     m_onFailure = std::move(onFailure);
+    m_onHedge = std::move(onHedge);
 
-    m_task =
-        TaskType(std::bind(&DataFetcher::onFutureCallback, this, _1, _2, _3));
+    if (!hedgeForwardingHint.empty())
+        m_hedgeForwardingHint.insert(1, hedgeForwardingHint);
 }
 
 void DataFetcher::stop() {
     if (this->isFetching()) {
         m_stop = true;
         m_interestId.cancel();
-        m_scheduler.cancelAllEvents();
-        m_task(-ECANCELED, m_interest, ndn::Data());
+        m_timers.cancel(m_backoffTimer);
+        cancelHedge();
+        complete(-ECANCELED, ndn::Block());
     }
 }
 
-void DataFetcher::fetch() { expressInterest(m_interest); }
+void DataFetcher::fetch(const InterestSpec &spec, uint64_t segmentNo,
+                        FetchCompletion *completion,
+                        ndn::time::nanoseconds hedgeDelay) {
+    setName(spec, segmentNo);
+    m_interest.setInterestLifetime(spec.lifetime);
+    m_interest.setMustBeFresh(spec.mustBeFresh);
+    m_interest.setCanBePrefix(false);
+    // The Interest is reused, so it must not go out with the previous nonce
+    m_interest.refreshNonce();
+    m_segmentNo = segmentNo;
+    m_completion = completion;
+    m_nNacks = 0;
+    m_nCongestionRetries = 0;
+    m_nTimeouts = 0;
+    m_error = false;
+    m_stop = false;
+    m_hedged = false;
+    m_hedgeWon = false;
+    m_hedgePending = false;
+    m_primaryErrcode = XRDNDN_ESUCCESS;
+    m_fetchTime = time::steady_clock::now();
+
+    expressInterest(m_interest);
+    if (hedgeDelay > time::nanoseconds::zero())
+        m_timers.arm(m_hedgeTimer, hedgeDelay);
+}
+
+void DataFetcher::setName(const InterestSpec &spec, uint64_t segmentNo) {
+    if (spec.prefix != m_prefix || spec.appendSegment != m_appendSegment) {
+        m_prefix = spec.prefix;
+        m_appendSegment = spec.appendSegment;
+        m_name = *spec.prefix;
+        if (m_appendSegment)
+            m_name.appendSegment(segmentNo);
+    } else if (m_appendSegment) {
+        m_name.set(-1, name::Component::fromSegment(segmentNo));
+    }
+    m_interest.setName(m_name);
+}
 
 bool DataFetcher::isFetching() { return !m_stop && !m_error; }
 
-DataFetcher::FutureType DataFetcher::get_future() {
-    return m_task.get_future();
+ndn::time::nanoseconds DataFetcher::getLatency() const {
+    return time::steady_clock::now() - m_fetchTime;
+}
+
+void DataFetcher::complete(int errcode, const ndn::Block &content) {
+    auto completion = m_completion;
+    m_completion = nullptr;
+
+    if (completion)
+        completion->onComplete(m_segmentNo, errcode, content);
+}
+
+void DataFetcher::fail(int errcode) {
+    m_error = true;
+    cancelHedge();
+    complete(errcode, ndn::Block());
+    m_onFailure(*this);
+}
+
+void DataFetcher::failPrimary(int errcode) {
+    // No hedge is expressed for an Interest given up
+    m_timers.cancel(m_hedgeTimer);
+    if (!m_hedgePending) {
+        fail(errcode);
+        return;
+    }
+
+    NDN_LOG_DEBUG("Original Interest: " << m_interest
+                                        << " given up, wait for the hedge");
+    m_primaryErrcode = errcode;
 }
 
-DataFetcher::DataTypeTuple
-DataFetcher::onFutureCallback(int errcode, const ndn::Interest &interest,
-                              const ndn::Data &data) {
-    return std::make_tuple(errcode, interest, data);
+int DataFetcher::validateData(const Data &data) {
+    int retValidate = XRDNDN_ESUCCESS;
+    m_validator.validate(
+        data,
+        [&](const Data &data) {
+            if (data.getContentType() == ndn::tlv::ContentType_Nack) {
+                NDN_LOG_ERROR("Received application level NACK for Interest: "
+                              << m_interest);
+                retValidate = -readNonNegativeInteger(data.getContent());
+            }
+        },
+        [&](const Data &, const security::v2::ValidationError &error) {
+            NDN_LOG_ERROR("Error: " << error.getInfo()
+                                    << " while validating Data for Interest: "
+                                    << m_interest);
+            retValidate = XRDNDN_EFAILURE;
+        });
+
+    return retValidate;
 }
 
-void DataFetcher::handleData(const Interest &interest, const Data &data) {
-    if (!this->isFetching())
+void DataFetcher::handleData(const Interest &interest, const Data &data,
+                             bool hedge) {
+    // A hedged Interest left over from a previous fetch is ignored
+    if (!this->isFetching() || (hedge && !m_hedged))
+        return;
+
+    NDN_LOG_TRACE("DataFetcher received Data for "
+                  << (hedge ? "hedged " : "") << "Interest: " << interest);
+
+    // Immutable Names are read without MustBeFresh, thus an error answered
+    // by the Producer may come from a cache that kept it. The Producer
+    // marks errors stale right away, so ask again with MustBeFresh
+    if (data.getContentType() == ndn::tlv::ContentType_Nack &&
+        !m_interest.getMustBeFresh()) {
+        NDN_LOG_DEBUG("Application level NACK for Interest: "
+                      << interest << ". Retry with MustBeFresh");
+        m_interestId.cancel();
+        m_timers.cancel(m_backoffTimer);
+        cancelHedge();
+        m_primaryErrcode = XRDNDN_ESUCCESS;
+        m_interest.setMustBeFresh(true);
+        m_interest.refreshNonce();
+        this->expressInterest(m_interest);
         return;
+    }
 
-    NDN_LOG_TRACE("DataFetcher received Data for Interest: " << interest);
+    // Only unambiguous samples are used for RTT estimation (Karn's algorithm)
+    time::nanoseconds rtt = time::nanoseconds::zero();
+    if (m_nNacks == 0 && m_nTimeouts == 0 && !m_hedged)
+        rtt = time::steady_clock::now() - m_sendTime;
 
     m_stop = true;
-    m_task(0, interest, data);
-    m_onSuccess(data);
+    m_hedgeWon = hedge;
+    if (hedge) {
+        m_interestId.cancel();
+        m_timers.cancel(m_backoffTimer);
+    } else {
+        cancelHedge();
+    }
+    int errcode = validateData(data);
+
+    const auto &finalBlock = data.getFinalBlock();
+    if (errcode == XRDNDN_ESUCCESS && m_completion && finalBlock &&
+        finalBlock->isSegment())
+        m_completion->onFinalBlock(finalBlock->toSegment());
+
+    complete(errcode, data.getContent());
+    m_onSuccess(*this, data, rtt);
 }
 
 void DataFetcher::handleNack(const Interest &interest, const lp::Nack &nack) {
@@ -93,20 +219,17 @@ void DataFetcher::handleNack(const Interest &interest, const lp::Nack &nack) {
     if (m_nNacks >= MAX_RETRIES_NACK) {
         NDN_LOG_ERROR("Reached the maximum number of NACK retries: "
                       << m_nNacks << " for Interest: " << interest);
-        m_error = true;
-        m_task(-ENETUNREACH, interest, ndn::Data());
-        m_onFailure();
+        failPrimary(-ENETUNREACH);
         return;
     } else {
         ++m_nNacks;
     }
 
-    Interest newInterest(interest);
-    newInterest.refreshNonce();
+    m_interest.refreshNonce();
 
     switch (nack.getReason()) {
     case lp::NackReason::DUPLICATE: {
-        this->expressInterest(newInterest);
+        this->expressInterest(m_interest);
         break;
     }
     case lp::NackReason::CONGESTION: {
@@ -118,16 +241,13 @@ void DataFetcher::handleNack(const Interest &interest, const lp::Nack &nack) {
         else
             ++m_nCongestionRetries;
 
-        m_scheduler.schedule(backOffTime, bind(&DataFetcher::expressInterest,
-                                               this, newInterest));
+        m_timers.arm(m_backoffTimer, backOffTime);
         break;
     }
     default:
         NDN_LOG_ERROR("NACK with reason " << nack.getReason()
                                           << " does not trigger a retry");
-        m_error = true;
-        m_task(-ENETUNREACH, interest, ndn::Data());
-        m_onFailure();
+        failPrimary(-ENETUNREACH);
         break;
     }
 }
@@ -138,31 +258,85 @@ void DataFetcher::handleTimeout(const Interest &interest) {
     if (m_nTimeouts >= MAX_RETRIES_TIMEOUT) {
         NDN_LOG_ERROR("Reached the maximum number of timeout retries: "
                       << m_nTimeouts << " for Interest: " << interest);
-        m_error = true;
-        m_task(-ETIMEDOUT, interest, ndn::Data());
-        m_onFailure();
+        failPrimary(-ETIMEDOUT);
         return;
     } else {
         ++m_nTimeouts;
     }
 
-    Interest newInterest(interest);
-    newInterest.refreshNonce();
-    this->expressInterest(newInterest);
+    m_interest.refreshNonce();
+    this->expressInterest(m_interest);
 }
 
 void DataFetcher::expressInterest(const Interest &interest) {
     NDN_LOG_TRACE("Express Interest: " << interest);
 
     m_nCongestionRetries = 0;
+    m_sendTime = time::steady_clock::now();
     try {
+        // Lambdas capturing only this fit in the small buffer of
+        // std::function, so expressing an Interest allocates no callbacks
         m_interestId = m_face.expressInterest(
-            interest, std::bind(&DataFetcher::handleData, this, _1, _2),
-            std::bind(&DataFetcher::handleNack, this, _1, _2),
-            std::bind(&DataFetcher::handleTimeout, this, _1));
+            interest,
+            [this](const Interest &interest, const Data &data) {
+                handleData(interest, data, false);
+            },
+            [this](const Interest &interest, const lp::Nack &nack) {
+                handleNack(interest, nack);
+            },
+            [this](const Interest &interest) { handleTimeout(interest); });
     } catch (const std::exception &e) {
         NDN_LOG_ERROR("Catch exception: " << e.what()
                                           << " while expressing Interest");
     }
 }
-} // namespace xrdndnconsumer
\ No newline at end of file
+
+void DataFetcher::expressHedge() {
+    if (!this->isFetching() || m_hedged || !m_onHedge(*this))
+        return;
+
+    Interest hedge(m_interest);
+    hedge.refreshNonce();
+    if (!m_hedgeForwardingHint.empty())
+        hedge.setForwardingHint(m_hedgeForwardingHint);
+
+    NDN_LOG_TRACE("Express hedged Interest: " << hedge);
+
+    m_hedged = true;
+    m_hedgePending = true;
+    try {
+        m_hedgeInterestId = m_face.expressInterest(
+            hedge,
+            [this](const Interest &interest, const Data &data) {
+                handleData(interest, data, true);
+            },
+            [this](const Interest &interest, const lp::Nack &) {
+                handleHedgeFailure(interest);
+            },
+            [this](const Interest &interest) { handleHedgeFailure(interest); });
+    } catch (const std::exception &e) {
+        NDN_LOG_ERROR("Catch exception: " << e.what()
+                                          << " while expressing Interest");
+        m_hedgePending = false;
+    }
+}
+
+void DataFetcher::handleHedgeFailure(const Interest &interest) {
+    if (!this->isFetching() || !m_hedgePending)
+        return;
+
+    NDN_LOG_TRACE("Hedged Interest: " << interest << " failed");
+    m_hedgePending = false;
+
+    // Unless the original Interest is still pending or being retried
+    if (m_primaryErrcode != XRDNDN_ESUCCESS)
+        fail(m_primaryErrcode);
+}
+
+void DataFetcher::cancelHedge() {
+    m_timers.cancel(m_hedgeTimer);
+    if (m_hedgePending)
+        m_hedgeInterestId.cancel();
+    m_hedgePending = false;
+}
+} // namespace xrdndnconsumer
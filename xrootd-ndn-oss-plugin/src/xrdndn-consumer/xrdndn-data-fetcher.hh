@@ -21,24 +21,71 @@
 #ifndef XRDNDN_DATA_FETCHER_HH
 #define XRDNDN_DATA_FETCHER_HH
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-
-#include <future>
-#include <tuple>
+#include <memory>
 
 #include <ndn-cxx/face.hpp>
-#include <ndn-cxx/util/scheduler.hpp>
+#include <ndn-cxx/security/v2/validator.hpp>
 #include <ndn-cxx/util/time.hpp>
 
 #include "../common/xrdndn-logger.hh"
+#include "xrdndn-timer-wheel.hh"
 
 namespace xrdndnconsumer {
 /**
- * @brief This class implements an NDN Data Fetcher. It takes care of only one
- * Interest packet and handles Nack, Timeout or Data for the Interest packet
+ * @brief Receiver of the outcome of a DataFetcher. Implemented by the requests
+ * waiting for Data (e.g. a read request living on the caller's stack), so that
+ * no callback object has to be allocated for each Interest
  *
  */
-class DataFetcher : public std::enable_shared_from_this<DataFetcher> {
+class FetchCompletion {
+  public:
+    virtual ~FetchCompletion() = default;
+
+    /**
+     * @brief Called once per fetched Interest
+     *
+     * @param segmentNo The segment number the Interest was inserted with
+     * @param errcode 0 on success, -ECANCELED on stop, -ENETUNREACH on Nack,
+     * -ETIMEDOUT on timeout, -1 if Data is not valid or the errcode set by
+     * Producer on application level NACK
+     * @param content On success the Content of Data for Interest. It shares
+     * the wire buffer of the Data, so no payload is copied. On failure, empty
+     * Block
+     */
+    virtual void onComplete(uint64_t segmentNo, int errcode,
+                            const ndn::Block &content) = 0;
+
+    /**
+     * @brief Called before onComplete if the valid Data carries the last
+     * segment number of the file as FinalBlockId
+     *
+     * @param finalSegmentNo The last segment number of the file
+     */
+    virtual void onFinalBlock(uint64_t finalSegmentNo) { (void)finalSegmentNo; }
+};
+
+/**
+ * @brief Everything but the segment number needed to build an Interest. The
+ * Name prefix is shared, so handing a spec over to the Face thread does not
+ * copy the Name
+ *
+ */
+struct InterestSpec {
+    // Name of the Interest, without the segment number if appendSegment
+    std::shared_ptr<const ndn::Name> prefix;
+    bool appendSegment = true;
+    bool mustBeFresh = true;
+    ndn::time::milliseconds lifetime = ndn::time::milliseconds::zero();
+};
+
+/**
+ * @brief This class implements an NDN Data Fetcher. It takes care of one
+ * Interest packet at a time and handles Nack, Timeout or Data for the Interest
+ * packet. Data Fetchers are slots of the Pipeline: they are created once and
+ * reused for every Interest expressed through the Pipeline
+ *
+ */
+class DataFetcher {
     /**
      * @brief Maximum no. of retries on receiving Nack Duplicate/Congestion
      * before setting error
@@ -59,56 +106,59 @@ class DataFetcher : public std::enable_shared_from_this<DataFetcher> {
      */
     static const ndn::time::milliseconds MAX_CONGESTION_BACKOFF_TIME;
 
-    using NotifyTaskCompleteSuccess = std::function<void(const ndn::Data &)>;
-    using NotifyTaskCompleteFailure = std::function<void()>;
-
-    using DataTypeTuple = std::tuple<int, ndn::Interest, ndn::Data>;
-    using FutureType = std::future<DataTypeTuple>;
-    using TaskType = std::packaged_task<DataTypeTuple(
-        int errcode, const ndn::Interest &interest, const ndn::Data &data)>;
+    using NotifyTaskCompleteSuccess =
+        std::function<void(DataFetcher &, const ndn::Data &,
+                           const ndn::time::nanoseconds &rtt)>;
+    using NotifyTaskCompleteFailure = std::function<void(DataFetcher &)>;
+    using NotifyHedge = std::function<bool(DataFetcher &)>;
 
   public:
-    /**
-     * @brief Get the Data Fetcher object
-     *
-     * @param face face Reference to NDN Face which provides a communication
-     * channel with local or remote NDN forwarder
-     * @param interest The Interest to be handled by this object
-     * @param onSuccess Pipeline callback called on receiving Data
-     * @param onFailure Pipeline callback called on failing expressing Interest
-     * @return std::shared_ptr<DataFetcher> Pointer to a new DataFetcher object
-     * for a specific Interest packet
-     */
-    static std::shared_ptr<DataFetcher>
-    getDataFetcher(ndn::Face &face, const ndn::Interest &interest,
-                   NotifyTaskCompleteSuccess onSuccess,
-                   NotifyTaskCompleteFailure onFailure);
-
     /**
      * @brief Construct a new Data Fetcher object
      *
      * @param face face Reference to NDN Face which provides a communication
      * channel with local or remote NDN forwarder
-     * @param interest The Interest to be handled by this object
-     * @param onSuccess Pipeline callback called on receiving Data
+     * @param validator Validator used to check received Data
+     * @param timers Timer wheel of the Face event loop, used for congestion
+     * backoff
+     * @param onSuccess Pipeline callback called on receiving Data. It also
+     * receives the RTT of the Interest, or zero if the Interest was
+     * retransmitted and the sample is ambiguous
      * @param onFailure Pipeline callback called on failing expressing Interest
+     * @param onHedge Pipeline callback called before expressing a hedged
+     * Interest. Returns false if the hedge budget is spent
+     * @param hedgeForwardingHint Forwarding hint set on hedged Interests, so
+     * that they may take another path. Empty to keep the original Interest
      */
-    DataFetcher(ndn::Face &face, const ndn::Interest &interest,
-                NotifyTaskCompleteSuccess onSuccess,
-                NotifyTaskCompleteFailure onFailure);
+    DataFetcher(ndn::Face &face, ndn::security::v2::Validator &validator,
+                TimerWheel &timers, NotifyTaskCompleteSuccess onSuccess,
+                NotifyTaskCompleteFailure onFailure, NotifyHedge onHedge,
+                const ndn::Name &hedgeForwardingHint);
 
     /**
-     * @brief Will cancel the pending Interest packet and free all allocated
-     * resources
+     * @brief Will cancel the pending Interest packet and notify the
+     * FetchCompletion with -ECANCELED
      *
      */
     void stop();
 
     /**
-     * @brief Start processing the Interest
+     * @brief Start processing an Interest. The Interest of the DataFetcher is
+     * reused: its Name is built again only if the prefix changed since the
+     * previous fetch, otherwise only the segment component is rewritten
      *
+     * @param spec The Interest to be handled
+     * @param segmentNo The segment number appended to the prefix, if the spec
+     * asks for it, and passed back to completion
+     * @param completion Notified when Data is available or failure occured
+     * @param hedgeDelay If the Interest is still outstanding after this
+     * delay, a duplicate Interest with a new nonce is expressed and the first
+     * Data received wins. Zero disables hedging
      */
-    void fetch();
+    void fetch(const InterestSpec &spec, uint64_t segmentNo,
+               FetchCompletion *completion,
+               ndn::time::nanoseconds hedgeDelay =
+                   ndn::time::nanoseconds::zero());
 
     /**
      * @brief Checks if the Interest packet is processed
@@ -120,35 +170,82 @@ class DataFetcher : public std::enable_shared_from_this<DataFetcher> {
     bool isFetching();
 
     /**
-     * @brief Get the future object
+     * @brief Time elapsed since the current Interest was first expressed,
+     * including all retransmissions
+     *
+     */
+    ndn::time::nanoseconds getLatency() const;
+
+    /**
+     * @brief Number of NACKs received for the current Interest
+     *
+     */
+    uint8_t getNackCount() const { return m_nNacks; }
+
+    /**
+     * @brief Number of timeouts of the current Interest
+     *
+     */
+    uint8_t getTimeoutCount() const { return m_nTimeouts; }
+
+    /**
+     * @brief Whether a hedged Interest was expressed for the current Interest
+     *
+     */
+    bool isHedged() const { return m_hedged; }
+
+    /**
+     * @brief Whether the Data of the current Interest came from the hedged
+     * Interest
      *
-     * @return FutureType Future set for Consumer. Synchronization of external
-     * requests on asynchronous processing
      */
-    FutureType get_future();
+    bool isHedgeWinner() const { return m_hedgeWon; }
 
   private:
     /**
-     * @brief Called to notify Consumer Data is available or failure occured
+     * @brief Notify FetchCompletion. After this call the DataFetcher does not
+     * belong to the request anymore
+     *
+     * @param errcode The errcode resulted while processing the Interest
+     * @param content On success the Content of Data for Interest
+     */
+    void complete(int errcode, const ndn::Block &content);
+
+    /**
+     * @brief Give up the segment: cancel the hedged Interest, if any, notify
+     * FetchCompletion and the Pipeline
+     *
+     * @param errcode The errcode passed to FetchCompletion
+     */
+    void fail(int errcode);
+
+    /**
+     * @brief Give up the original Interest. The segment fails right away,
+     * unless a hedged Interest is still outstanding: then it is up to the
+     * hedge, and the segment fails only if the hedge fails too
+     *
+     * @param errcode The errcode passed to FetchCompletion on failure
+     */
+    void failPrimary(int errcode);
+
+    /**
+     * @brief Validate Data received for the Interest
      *
-     * @param errcode The errcode resulted while processing the Interest. 0 on
-     * success, -ECANCELED on stop, -ENETUNREACH on Nack, -ETIMEDOUT on timeout
-     * @param interest Processed Interest
-     * @param data On success Data for Interest. On failure, empty object with
-     * corresponding errcode
-     * @return DataTypeTuple A tuple combining errcode, Interest and Data for
-     * Consumer to process
+     * @param data The Data packet
+     * @return int 0 if Data is valid, -1 if Data is not valid or the errcode
+     * set by Producer if Data is an application level NACK
      */
-    DataTypeTuple onFutureCallback(int errcode, const ndn::Interest &interest,
-                                   const ndn::Data &data);
+    int validateData(const ndn::Data &data);
 
     /**
      * @brief Method called when receiving Data for Interest packet
      *
      * @param interest The Interest packet
      * @param data The Data packet for the Interest packet
+     * @param hedge The Data is for the hedged Interest
      */
-    void handleData(const ndn::Interest &interest, const ndn::Data &data);
+    void handleData(const ndn::Interest &interest, const ndn::Data &data,
+                    bool hedge);
 
     /**
      * @brief Method called when receiving NACK for Interest packet. Sends
@@ -174,14 +271,57 @@ class DataFetcher : public std::enable_shared_from_this<DataFetcher> {
      */
     void expressInterest(const ndn::Interest &interest);
 
+    /**
+     * @brief Set the Name of the Interest for a new fetch
+     *
+     */
+    void setName(const InterestSpec &spec, uint64_t segmentNo);
+
+    /**
+     * @brief Express a duplicate of the current Interest with a new nonce and
+     * the hedge forwarding hint, if allowed by the Pipeline
+     *
+     */
+    void expressHedge();
+
+    /**
+     * @brief Method called when the hedged Interest is NACKed or times out.
+     * The hedge is dropped and the original Interest keeps being retried. If
+     * the original Interest has already been given up, the segment fails
+     *
+     * @param interest The hedged Interest packet
+     */
+    void handleHedgeFailure(const ndn::Interest &interest);
+
+    /**
+     * @brief Cancel the hedge timer and the hedged Interest, if any
+     *
+     */
+    void cancelHedge();
+
   private:
     NotifyTaskCompleteSuccess m_onSuccess;
     NotifyTaskCompleteFailure m_onFailure;
+    NotifyHedge m_onHedge;
 
     ndn::Face &m_face;
-    ndn::util::scheduler::Scheduler m_scheduler;
-    const ndn::Interest m_interest;
+    ndn::security::v2::Validator &m_validator;
+    TimerWheel &m_timers;
+    TimerWheel::Timer m_backoffTimer;
+    TimerWheel::Timer m_hedgeTimer;
+    ndn::Interest m_interest;
+    // Prefix and Name of the previous fetch, reused if the prefix is the same
+    std::shared_ptr<const ndn::Name> m_prefix;
+    bool m_appendSegment;
+    ndn::Name m_name;
     ndn::PendingInterestHandle m_interestId;
+    ndn::PendingInterestHandle m_hedgeInterestId;
+    ndn::DelegationList m_hedgeForwardingHint;
+    ndn::time::steady_clock::TimePoint m_sendTime;
+    ndn::time::steady_clock::TimePoint m_fetchTime;
+
+    uint64_t m_segmentNo;
+    FetchCompletion *m_completion;
 
     uint8_t m_nNacks;
     uint8_t m_nCongestionRetries;
@@ -189,9 +329,14 @@ class DataFetcher : public std::enable_shared_from_this<DataFetcher> {
 
     bool m_error;
     bool m_stop;
-
-    TaskType m_task;
+    bool m_hedged;
+    bool m_hedgeWon;
+    // The hedged Interest is outstanding
+    bool m_hedgePending;
+    // Set when the original Interest has been given up while the hedged one
+    // was outstanding
+    int m_primaryErrcode;
 };
 } // namespace xrdndnconsumer
 
-#endif // XRDNDN_DATA_FETCHER_HH
\ No newline at end of file
+#endif // XRDNDN_DATA_FETCHER_HH
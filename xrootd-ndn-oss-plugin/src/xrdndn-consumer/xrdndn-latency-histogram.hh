@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_LATENCY_HISTOGRAM_HH
+#define XRDNDN_LATENCY_HISTOGRAM_HH
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace xrdndnconsumer {
+/**
+ * @brief Log-linear histogram of latencies in microseconds. Values below 64us
+ * are recorded exactly and larger ones in 32 buckets per power of two, thus
+ * percentiles are accurate within about 3% for any latency and recording a
+ * value never allocates memory. Not thread safe
+ *
+ */
+class LatencyHistogram {
+    static const unsigned SUB_BUCKET_BITS = 5;
+    static const uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const size_t NBUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  public:
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        m_buckets.fill(0);
+        m_count = 0;
+        m_sum = 0;
+        m_max = 0;
+    }
+
+    /**
+     * @brief Record one latency
+     *
+     * @param us The latency in microseconds
+     */
+    void record(uint64_t us) {
+        ++m_buckets[getBucket(us)];
+        ++m_count;
+        m_sum += us;
+        m_max = std::max(m_max, us);
+    }
+
+    /**
+     * @brief Add all values recorded by another histogram
+     *
+     */
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < NBUCKETS; ++i)
+            m_buckets[i] += other.m_buckets[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    uint64_t getCount() const { return m_count; }
+
+    uint64_t getMax() const { return m_max; }
+
+    double getMean() const {
+        return m_count == 0 ? 0 : static_cast<double>(m_sum) / m_count;
+    }
+
+    /**
+     * @brief Get a percentile of the recorded latencies
+     *
+     * @param percentile The percentile, between 0 and 100 (e.g. 99.9)
+     * @return uint64_t The upper bound in microseconds of the bucket holding
+     * the percentile, or 0 if nothing was recorded
+     */
+    uint64_t getPercentile(double percentile) const {
+        if (m_count == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(
+            std::ceil(percentile / 100 * static_cast<double>(m_count)));
+        rank = std::max<uint64_t>(rank, 1);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < NBUCKETS; ++i) {
+            seen += m_buckets[i];
+            if (seen >= rank)
+                return std::min(getBucketUpperBound(i), m_max);
+        }
+        return m_max;
+    }
+
+  private:
+    static size_t getBucket(uint64_t us) {
+        if (us < SUB_BUCKETS)
+            return us;
+
+        unsigned msb = 63 - __builtin_clzll(us);
+        unsigned shift = msb - SUB_BUCKET_BITS;
+        return shift * SUB_BUCKETS + (us >> shift);
+    }
+
+    static uint64_t getBucketUpperBound(size_t bucket) {
+        if (bucket < 2 * SUB_BUCKETS)
+            return bucket;
+
+        unsigned shift = bucket / SUB_BUCKETS - 1;
+        uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+  private:
+    std::array<uint64_t, NBUCKETS> m_buckets;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_max;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_LATENCY_HISTOGRAM_HH
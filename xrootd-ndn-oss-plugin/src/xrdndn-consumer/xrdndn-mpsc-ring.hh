@@ -0,0 +1,122 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_MPSC_RING_HH
+#define XRDNDN_MPSC_RING_HH
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace xrdndnconsumer {
+/**
+ * @brief Bounded lock-free ring for many producers and a single consumer. Each
+ * cell carries a sequence number telling whether it is free for the producer
+ * of a given round or filled for the consumer, thus producers only contend on
+ * one atomic position and never block. Cells are allocated once, with the ring
+ *
+ * @tparam T Type of the elements. Must be default constructible and copy
+ * assignable
+ */
+template <typename T> class MpscRing : private boost::noncopyable {
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+  public:
+    /**
+     * @brief Construct a new Mpsc Ring object
+     *
+     * @param capacity Minimum number of elements. Rounded up to a power of two
+     */
+    explicit MpscRing(size_t capacity) : m_enqueuePos(0), m_dequeuePos(0) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        m_mask = size - 1;
+        m_cells = std::vector<Cell>(size);
+        for (size_t i = 0; i < size; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add an element. Can be called concurrently from any thread
+     *
+     * @param value The element
+     * @return true The element has been added
+     * @return false The ring is full
+     */
+    bool push(T value) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = m_cells[pos & m_mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) -
+                            static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Take the oldest element. Must be called from the consumer thread
+     * only
+     *
+     * @param value Where the element is moved to
+     * @return true An element has been taken
+     * @return false The ring is empty
+     */
+    bool pop(T &value) {
+        Cell &cell = m_cells[m_dequeuePos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != m_dequeuePos + 1)
+            return false;
+
+        value = std::move(cell.value);
+        cell.sequence.store(m_dequeuePos + m_mask + 1,
+                            std::memory_order_release);
+        ++m_dequeuePos;
+        return true;
+    }
+
+  private:
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+    std::atomic<size_t> m_enqueuePos;
+    size_t m_dequeuePos;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_MPSC_RING_HH
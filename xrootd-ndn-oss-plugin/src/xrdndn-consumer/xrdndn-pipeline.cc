@@ -18,6 +18,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
  *****************************************************************************/
 
+#include <cmath>
+
 #include <ndn-cxx/util/time.hpp>
 
 #include "../common/xrdndn-utils.hh"
@@ -26,94 +28,346 @@
 using namespace ndn;
 
 namespace xrdndnconsumer {
-Pipeline::Pipeline(Face &face, size_t size)
-    : m_face(face), m_size(size), m_stop(false), m_pipeNo(0),
-      m_nSegmentsReceived(0), m_nBytesReceived(0), m_duration(0) {
+/**
+ * @brief EWMA gain for the smoothed RTT (RFC 6298)
+ *
+ */
+static const double RTT_ALPHA = 0.125;
+/**
+ * @brief EWMA gain for the delivery rate
+ *
+ */
+static const double RATE_ALPHA = 0.25;
+/**
+ * @brief Number of segments over which one delivery rate sample is taken
+ *
+ */
+static const uint64_t RATE_SAMPLE_SEGMENTS = 32;
+/**
+ * @brief Number of segment latencies over which the hedge delay is computed.
+ * The latencies are then discarded, so the delay follows recent RTTs
+ *
+ */
+static const uint64_t HEDGE_SAMPLE_SEGMENTS = 1024;
+
+using DoubleMilliseconds =
+    ndn::time::duration<double, ndn::time::milliseconds::period>;
+
+Pipeline::Pipeline(Face &face, security::v2::Validator &validator,
+                   TimerWheel &timers, const Options &opts)
+    : m_ioService(face.getIoService()), m_size(opts.pipelineSize),
+      m_fetchers(opts.pipelineSize, face, validator, timers,
+                 std::bind(&Pipeline::onTaskCompleteSuccess, this, _1, _2, _3),
+                 std::bind(&Pipeline::onTaskCompleteFailure, this, _1),
+                 std::bind(&Pipeline::onTaskHedge, this, _1),
+                 ndn::Name(opts.hedgeForwardingHint)),
+      m_requests(opts.pipelineSize), m_drainScheduled(false),
+      m_nInserting(0), m_nReserved(0), m_nWaiters(0), m_nSlotWaiters(0),
+      m_stop(false),
+      m_nSegmentsReceived(0), m_nBytesReceived(0), m_duration(0),
+      m_nNacks(0), m_nTimeouts(0), m_nFailures(0), m_srtt(0), m_rate(0),
+      m_nRateSamples(0), m_bdp(0), m_hedgePercentile(opts.hedgePercentile),
+      m_hedgeBudget(opts.hedgeBudget / 100),
+      m_hedgeDelay(ndn::time::nanoseconds::zero()), m_nFetched(0),
+      m_nHedges(0), m_nHedgesWon(0) {
     NDN_LOG_TRACE("Alloc fixed window size " << m_size << " pipeline");
     m_startTime = ndn::time::steady_clock::now();
 }
 
 Pipeline::~Pipeline() {
-    if (!m_window.empty()) {
+    if (!m_stop)
         stop();
-        m_window.clear();
-    }
 }
 
 void Pipeline::stop() {
     m_stop = true;
-    m_duration += ndn::time::steady_clock::now() - m_startTime;
+
+    // Requests that passed the stop check are in the ring after this
+    while (m_nInserting > 0)
+        boost::this_thread::yield();
 
     {
-        boost::unique_lock<boost::mutex> lock(m_mtxWindow);
-        for (auto it = m_window.begin(); it != m_window.end(); ++it) {
-            if (it->second->isFetching())
-                it->second->stop();
-        }
+        boost::lock_guard<boost::mutex> lock(m_mtxWindow);
     }
     m_cvWindow.notify_all();
+    // Waiters find the Pipeline stopped and give up
+    this->notifySlotWaiters();
+
+    {
+        boost::lock_guard<boost::mutex> lock(m_mtxStatistics);
+        m_duration += ndn::time::steady_clock::now() - m_startTime;
+    }
+
+    m_fetchers.stop();
+    this->drain();
+    m_fetchers.forEach([](DataFetcher &fetcher) {
+        if (fetcher.isFetching())
+            fetcher.stop();
+    });
+}
+
+bool Pipeline::insert(const InterestSpec &spec, uint64_t segmentNo,
+                      FetchCompletion *completion) {
+    if (!this->reserve(true))
+        return false;
+
+    return this->push(spec, segmentNo, completion);
+}
+
+bool Pipeline::insert(const ndn::Interest &interest, uint64_t segmentNo,
+                      FetchCompletion *completion) {
+    InterestSpec spec;
+    spec.prefix = std::make_shared<const ndn::Name>(interest.getName());
+    spec.appendSegment = false;
+    spec.mustBeFresh = interest.getMustBeFresh();
+    spec.lifetime = interest.getInterestLifetime();
+    return this->insert(spec, segmentNo, completion);
+}
+
+bool Pipeline::tryInsert(const InterestSpec &spec, uint64_t segmentNo,
+                         FetchCompletion *completion) {
+    if (!this->reserve(false))
+        return false;
+
+    return this->push(spec, segmentNo, completion);
+}
+
+bool Pipeline::waitForSlot(std::function<void()> callback) {
+    ++m_nInserting;
+    if (m_stop) {
+        --m_nInserting;
+        return false;
+    }
+
+    {
+        boost::lock_guard<boost::mutex> lock(m_mtxSlotWaiters);
+        m_slotWaiters.push_back(std::move(callback));
+        ++m_nSlotWaiters;
+    }
+    --m_nInserting;
+
+    // A place may have been given back before the waiter was registered
+    if (m_nReserved < m_size)
+        m_ioService.post([this]() { this->notifySlotWaiters(); });
+    return true;
 }
 
-Pipeline::FutureType Pipeline::insert(const ndn::Interest &interest) {
-    boost::unique_lock<boost::mutex> lock(m_mtxWindow);
-    m_cvWindow.wait(lock,
-                    [&]() { return (m_window.size() < m_size) || m_stop; });
+bool Pipeline::reserve(bool block) {
+    size_t nReserved = m_nReserved.load();
+    for (;;) {
+        if (m_stop)
+            return false;
 
+        if (nReserved < m_size) {
+            if (m_nReserved.compare_exchange_weak(nReserved, nReserved + 1))
+                return true;
+            continue;
+        }
+
+        if (!block)
+            return false;
+
+        // Slow path, the window is full
+        boost::unique_lock<boost::mutex> lock(m_mtxWindow);
+        ++m_nWaiters;
+        m_cvWindow.wait(lock, [&]() {
+            nReserved = m_nReserved.load();
+            return nReserved < m_size || m_stop;
+        });
+        --m_nWaiters;
+    }
+}
+
+void Pipeline::unreserve() {
+    if (m_nReserved.fetch_sub(1) == 1) {
+        boost::lock_guard<boost::mutex> lock(m_mtxStatistics);
+        m_duration += ndn::time::steady_clock::now() - m_startTime;
+        m_startTime = ndn::time::steady_clock::now();
+    }
+
+    if (m_nWaiters > 0) {
+        boost::lock_guard<boost::mutex> lock(m_mtxWindow);
+        m_cvWindow.notify_one();
+    }
+}
+
+bool Pipeline::push(const InterestSpec &spec, uint64_t segmentNo,
+                    FetchCompletion *completion) {
+    ++m_nInserting;
     if (m_stop) {
         NDN_LOG_TRACE("Pipeline will stop. Interest: "
-                      << interest << " will not be processed");
-        return FutureType();
+                      << *spec.prefix << " segment: " << segmentNo
+                      << " will not be processed");
+        --m_nInserting;
+        this->unreserve();
+        return false;
     }
 
-    uint64_t pipeNo = m_pipeNo++;
-    auto fetcher = DataFetcher::getDataFetcher(
-        m_face, interest,
-        std::bind(&Pipeline::onTaskCompleteSuccess, this, _1, pipeNo),
-        std::bind(&Pipeline::onTaskCompleteFailure, this));
+    // The ring holds as many requests as the window, so it is never full
+    bool pushed = m_requests.push(Request{spec, segmentNo, completion});
+    if (pushed && !m_drainScheduled.exchange(true))
+        m_ioService.post([this]() { this->drain(); });
+    --m_nInserting;
 
-    if (!fetcher) {
-        NDN_LOG_ERROR(
-            "Could not get DataFetcher object for Interest: " << interest);
-        return FutureType();
+    if (!pushed) {
+        NDN_LOG_ERROR("Request ring full for Interest: "
+                      << *spec.prefix << " segment: " << segmentNo);
+        this->unreserve();
     }
+    return pushed;
+}
 
-    NDN_LOG_TRACE("Processing Interest: " << interest);
-    m_window.emplace(
-        std::pair<uint64_t, std::shared_ptr<DataFetcher>>(pipeNo, fetcher));
-    auto future = m_window[pipeNo]->get_future();
-    m_window[pipeNo]->fetch();
+void Pipeline::drain() {
+    m_drainScheduled = false;
+
+    while (m_requests.pop(m_drained)) {
+        // A reserved place always has a free DataFetcher, unless stopped
+        DataFetcher *fetcher = m_fetchers.tryAcquire();
+        if (!fetcher) {
+            NDN_LOG_TRACE("Pipeline will stop. Interest: "
+                          << *m_drained.spec.prefix
+                          << " segment: " << m_drained.segmentNo
+                          << " will not be processed");
+            this->unreserve();
+            m_drained.completion->onComplete(m_drained.segmentNo, -ECANCELED,
+                                             ndn::Block());
+            continue;
+        }
 
-    return future;
+        if (m_fetchers.inUse() == 1) {
+            // The delivery rate is only sampled while the window is busy
+            m_nRateSamples = 0;
+            m_rateStartTime = ndn::time::steady_clock::now();
+        }
+
+        NDN_LOG_TRACE("Processing Interest: " << *m_drained.spec.prefix
+                                              << " segment: "
+                                              << m_drained.segmentNo);
+        ++m_nFetched;
+        fetcher->fetch(m_drained.spec, m_drained.segmentNo,
+                       m_drained.completion, m_hedgeDelay);
+    }
 }
 
-void Pipeline::onTaskCompleteSuccess(const ndn::Data &data,
-                                     const uint64_t &pipeNo) {
+void Pipeline::notifySlotWaiters() {
+    // A waiter that finds the window full again registers itself once more,
+    // which ends the loop
+    while (m_nSlotWaiters > 0 && (m_nReserved < m_size || m_stop)) {
+        std::function<void()> callback;
+        {
+            boost::lock_guard<boost::mutex> lock(m_mtxSlotWaiters);
+            if (m_slotWaiters.empty())
+                return;
+            callback = std::move(m_slotWaiters.front());
+            m_slotWaiters.pop_front();
+            --m_nSlotWaiters;
+        }
+        callback();
+    }
+}
+
+size_t Pipeline::getBdpSegments() { return m_bdp; }
+
+void Pipeline::updateEstimations(const ndn::time::nanoseconds &rtt) {
+    if (rtt > ndn::time::nanoseconds::zero()) {
+        double sample = DoubleMilliseconds(rtt).count();
+        m_srtt = m_srtt == 0 ? sample
+                             : (1 - RTT_ALPHA) * m_srtt + RTT_ALPHA * sample;
+    }
+
+    if (++m_nRateSamples < RATE_SAMPLE_SEGMENTS)
+        return;
+
+    auto now = ndn::time::steady_clock::now();
+    double elapsed = DoubleMilliseconds(now - m_rateStartTime).count();
+    if (elapsed > 0) {
+        double sample = m_nRateSamples / elapsed;
+        m_rate = m_rate == 0 ? sample
+                             : (1 - RATE_ALPHA) * m_rate + RATE_ALPHA * sample;
+    }
+
+    m_nRateSamples = 0;
+    m_rateStartTime = now;
+    m_bdp = static_cast<size_t>(std::ceil(m_rate * m_srtt));
+}
+
+void Pipeline::updateHedgeDelay(const DataFetcher &fetcher) {
+    if (m_hedgePercentile <= 0 || fetcher.getNackCount() > 0 ||
+        fetcher.getTimeoutCount() > 0)
+        return;
+
+    // Hedged segments are recorded too, otherwise the slowest segments would
+    // be left out and the delay would keep shrinking
+    m_recentLatency.record(ndn::time::duration_cast<ndn::time::microseconds>(
+                               fetcher.getLatency())
+                               .count());
+    if (m_recentLatency.getCount() < HEDGE_SAMPLE_SEGMENTS)
+        return;
+
+    m_hedgeDelay = ndn::time::microseconds(std::max<uint64_t>(
+        m_recentLatency.getPercentile(m_hedgePercentile), 1000));
+    m_recentLatency.reset();
+    NDN_LOG_DEBUG("Hedge Interests outstanding for more than: "
+                  << m_hedgeDelay);
+}
+
+void Pipeline::onTaskCompleteSuccess(DataFetcher &fetcher,
+                                     const ndn::Data &data,
+                                     const ndn::time::nanoseconds &rtt) {
     m_nSegmentsReceived++;
     m_nBytesReceived += data.getContent().value_size();
 
+    {
+        boost::lock_guard<boost::mutex> lock(m_mtxStatistics);
+        m_nNacks += fetcher.getNackCount();
+        m_nTimeouts += fetcher.getTimeoutCount();
+        m_latency.record(
+            ndn::time::duration_cast<ndn::time::microseconds>(
+                fetcher.getLatency())
+                .count());
+    }
+    if (fetcher.isHedgeWinner())
+        ++m_nHedgesWon;
+
     if (m_stop)
         return;
 
-    {
-        boost::unique_lock<boost::mutex> lock(m_mtxWindow);
-        m_window.erase(pipeNo);
+    this->updateEstimations(rtt);
+    this->updateHedgeDelay(fetcher);
+    m_fetchers.release(&fetcher);
+    this->unreserve();
+    this->notifySlotWaiters();
+}
 
-        if (m_window.empty()) {
-            m_duration += ndn::time::steady_clock::now() - m_startTime;
-            m_startTime = ndn::time::steady_clock::now();
-        }
+void Pipeline::onTaskCompleteFailure(DataFetcher &fetcher) {
+    {
+        boost::lock_guard<boost::mutex> lock(m_mtxStatistics);
+        m_nNacks += fetcher.getNackCount();
+        m_nTimeouts += fetcher.getTimeoutCount();
+        ++m_nFailures;
     }
-    m_cvWindow.notify_one();
-}
 
-void Pipeline::onTaskCompleteFailure() {
     if (m_stop) {
         return;
     }
 
     NDN_LOG_ERROR("Pipeline task failed. New Interests will not be processed");
     m_stop = true;
+    m_fetchers.stop();
+
+    {
+        boost::lock_guard<boost::mutex> lock(m_mtxWindow);
+    }
     m_cvWindow.notify_all();
+    this->notifySlotWaiters();
+}
+
+bool Pipeline::onTaskHedge(DataFetcher &) {
+    if (m_stop || m_nHedges + 1 > m_hedgeBudget * m_nFetched)
+        return false;
+
+    ++m_nHedges;
+    return true;
 }
 
 void Pipeline::getStatistics(std::string path) {
@@ -126,4 +380,22 @@ void Pipeline::getStatistics(std::string path) {
               << static_cast<double>(m_nBytesReceived) / 1000000 << " MB"
               << "\nThroughput: " << throughput << " Mbit/s\n";
 }
+
+bool Pipeline::isStopped() const { return m_stop; }
+
+Pipeline::Statistics Pipeline::getStatisticsSnapshot() {
+    Statistics statistics;
+    statistics.nSegmentsReceived = m_nSegmentsReceived;
+    statistics.nBytesReceived = m_nBytesReceived;
+    statistics.nHedges = m_nHedges;
+    statistics.nHedgesWon = m_nHedgesWon;
+
+    boost::lock_guard<boost::mutex> lock(m_mtxStatistics);
+    statistics.nNacks = m_nNacks;
+    statistics.nTimeouts = m_nTimeouts;
+    statistics.nRetransmissions = m_nNacks + m_nTimeouts;
+    statistics.nFailures = m_nFailures;
+    statistics.latency = m_latency;
+    return statistics;
+}
 } // namespace xrdndnconsumer
\ No newline at end of file
@@ -22,36 +22,81 @@
 #define XRDNDN_PIPELINE_HH
 
 #include <atomic>
-#include <unordered_map>
+#include <deque>
+#include <functional>
 
 #include <ndn-cxx/face.hpp>
 
 #include "../common/xrdndn-logger.hh"
+#include "xrdndn-consumer-options.hh"
 #include "xrdndn-data-fetcher.hh"
+#include "xrdndn-latency-histogram.hh"
+#include "xrdndn-mpsc-ring.hh"
+#include "xrdndn-slot-pool.hh"
 
 namespace xrdndnconsumer {
 /**
  * @brief This class implements a fixed window size pipeline. By using
- * DataFetcher class, Interest packets will be handled in a controlled manner
+ * DataFetcher class, Interest packets will be handled in a controlled manner.
+ *
+ * Application threads reserve a place in the window with atomic operations and
+ * push their request in a lock-free ring. The Face thread drains the ring in
+ * batches and expresses the Interests, so that all Face operations stay on the
+ * event loop. The window is a pool of DataFetcher objects allocated when the
+ * Pipeline is created and used by the Face thread only, thus inserting an
+ * Interest does not allocate memory
  *
  */
 class Pipeline {
-    using NotifyTaskCompleteSuccess = std::function<void(const ndn::Data &)>;
-    using NotifyTaskCompleteFailure = std::function<void()>;
-
-    using DataTypeTuple = std::tuple<int, ndn::Interest, ndn::Data>;
-    using FutureType = std::future<DataTypeTuple>;
+    /**
+     * @brief Interest request handed over from application threads to the
+     * Face thread. It carries no Name of its own: the DataFetcher builds the
+     * Interest from the shared prefix and the segment number
+     *
+     */
+    struct Request {
+        InterestSpec spec;
+        uint64_t segmentNo = 0;
+        FetchCompletion *completion = nullptr;
+    };
 
   public:
+    /**
+     * @brief Transfer counters and segment latency distribution of the
+     * Pipeline since it was created
+     *
+     */
+    struct Statistics {
+        uint64_t nSegmentsReceived = 0;
+        uint64_t nBytesReceived = 0;
+        // Interests expressed again after a NACK or a timeout
+        uint64_t nRetransmissions = 0;
+        uint64_t nNacks = 0;
+        uint64_t nTimeouts = 0;
+        // Segments given up after too many retransmissions
+        uint64_t nFailures = 0;
+        // Duplicate Interests expressed for slow segments
+        uint64_t nHedges = 0;
+        // Segments whose Data came from the hedged Interest
+        uint64_t nHedgesWon = 0;
+        // From the first expression of an Interest to its Data
+        LatencyHistogram latency;
+    };
+
     /**
      * @brief Construct a new Fixed Window Size Pipeline object
      *
      * @param face Reference to NDN Face which provides a communication channel
      * with local or remote NDN forwarder
-     * @param size Fixed window size of Pipeline. The maximum concurrent
-     * Interest packets expressed at one time
+     * @param validator Validator used to check all received Data
+     * @param timers Timer wheel of the Face event loop, shared by all
+     * DataFetchers
+     * @param opts Consumer options. The pipeline size is the maximum
+     * number of concurrent Interest packets expressed at one time. The hedge
+     * options enable hedged Interests
      */
-    Pipeline(ndn::Face &face, size_t size);
+    Pipeline(ndn::Face &face, ndn::security::v2::Validator &validator,
+             TimerWheel &timers, const Options &opts);
 
     /**
      * @brief Destroy the Pipeline object
@@ -60,7 +105,9 @@ class Pipeline {
     ~Pipeline();
 
     /**
-     * @brief Stops Pipeline execution. All expressed Interests are canceled
+     * @brief Stops Pipeline execution. All expressed and queued Interests are
+     * canceled. Must be called from the Face thread or after the Face event
+     * loop has stopped
      *
      */
     void stop();
@@ -69,14 +116,66 @@ class Pipeline {
      * @brief Insert a new Interest in Pipeline to be processed. When a slot is
      * available, the Interest will be expressed
      *
-     * @param interest The Interest to be expressed
-     * @return FutureType Tasks (DataFetcher) in Pipeline are asynchronous, but
-     * the read of chunk from a file needs to be synchronous, thus the
-     * syncronization is done by using std::futures. When the Data is available
-     * for an expressed Interest, the Consumer will be notified and a slot will
-     * become available in Pipeline
+     * @param spec The Interest to be expressed, without its segment number
+     * @param segmentNo The segment number of the Interest, passed back to
+     * completion
+     * @param completion Notified exactly once, from the face thread, when Data
+     * is available or the Interest failed. It must outlive the Interest
+     * @return true The Interest has been queued for the Face thread
+     * @return false The Pipeline is stopped. The completion will not be
+     * notified
      */
-    FutureType insert(const ndn::Interest &interest);
+    bool insert(const InterestSpec &spec, uint64_t segmentNo,
+                FetchCompletion *completion);
+
+    /**
+     * @brief Insert a new Interest for a Name that has no segment number (e.g.
+     * open or fstat). The Name is copied, thus it should not be used for file
+     * segments
+     *
+     */
+    bool insert(const ndn::Interest &interest, uint64_t segmentNo,
+                FetchCompletion *completion);
+
+    /**
+     * @brief Insert a new Interest in Pipeline only if a slot is available
+     * right now. Used for opportunistic requests (e.g. readahead) that must
+     * not block the caller
+     *
+     * @param spec The Interest to be expressed, without its segment number
+     * @param segmentNo The segment number of the Interest, passed back to
+     * completion
+     * @param completion Notified exactly once when Data is available or the
+     * Interest failed
+     * @return true The Interest has been queued for the Face thread
+     * @return false The window is full or the Pipeline is stopped. The
+     * completion will not be notified
+     */
+    bool tryInsert(const InterestSpec &spec, uint64_t segmentNo,
+                   FetchCompletion *completion);
+
+    /**
+     * @brief Wait for a place in the window without blocking the caller. Used
+     * after tryInsert failed by requests that must not block (e.g. ReadAsync),
+     * which go on from the callback
+     *
+     * @param callback Called once from the Face thread when a place may be
+     * free, or when the Pipeline is stopped. tryInsert can fail again, e.g. if
+     * an inserter blocked in insert took the place first
+     * @return true The callback has been registered
+     * @return false The Pipeline is stopped. The callback will not be called
+     */
+    bool waitForSlot(std::function<void()> callback);
+
+    /**
+     * @brief Get the estimated bandwidth-delay product of the path, computed
+     * from the smoothed RTT and the delivery rate measured while the window is
+     * busy
+     *
+     * @return size_t The number of segments in flight needed to fill the path.
+     * 0 if not enough samples have been collected yet
+     */
+    size_t getBdpSegments();
 
     /**
      * @brief Print throughput information
@@ -85,43 +184,155 @@ class Pipeline {
      */
     void getStatistics(std::string path = "N/A");
 
+    /**
+     * @brief Get a consistent copy of the transfer counters and of the segment
+     * latency distribution. Can be called from any thread while the transfer
+     * is running
+     *
+     */
+    Statistics getStatisticsSnapshot();
+
+    /**
+     * @brief Check if the Pipeline has been stopped, either explicitly or
+     * because a task failed
+     *
+     */
+    bool isStopped() const;
+
   private:
+    /**
+     * @brief Reserve a place in the window
+     *
+     * @param block Wait for a place if the window is full
+     * @return true A place has been reserved
+     * @return false The window is full and block is false, or the Pipeline is
+     * stopped
+     */
+    bool reserve(bool block);
+
+    /**
+     * @brief Give back a place in the window and wake up a waiting inserter
+     *
+     */
+    void unreserve();
+
+    /**
+     * @brief Queue a request for a reserved place and wake up the Face thread
+     *
+     * @return true The request has been queued
+     * @return false The Pipeline is stopped
+     */
+    bool push(const InterestSpec &spec, uint64_t segmentNo,
+              FetchCompletion *completion);
+
+    /**
+     * @brief Express all queued requests. Runs on the Face thread
+     *
+     */
+    void drain();
+
+    /**
+     * @brief Call the slot waiters while the window has free places, or all of
+     * them if the Pipeline is stopped. Runs on the Face thread
+     *
+     */
+    void notifySlotWaiters();
+
+    /**
+     * @brief Update RTT and delivery rate estimations. Runs on the Face thread
+     *
+     * @param rtt The RTT sample. Ignored if zero
+     */
+    void updateEstimations(const ndn::time::nanoseconds &rtt);
+
+    /**
+     * @brief Record the latency of a segment fetched without retransmissions
+     * and, once enough samples have been collected, compute the delay after
+     * which Interests are hedged. Runs on the Face thread
+     *
+     */
+    void updateHedgeDelay(const DataFetcher &fetcher);
+
     /**
      * @brief Callback function for when task in Pipeline - DataFetcher has Data
      * for Interest. When this is called, the Consumer already has the Data. The
-     * DataFetcher object can be destroyed a new Interest can be processed in
+     * DataFetcher goes back to the pool and a new Interest can be processed in
      * Pipeline
      *
+     * @param fetcher The DataFetcher that completed the Interest
      * @param data Data for expressed Interest
-     * @param pipeNo Task number in Pipeline. Used to keep track of it until
-     * destruction
+     * @param rtt RTT of the expressed Interest. Zero if ambiguous
      */
-    void onTaskCompleteSuccess(const ndn::Data &data, const uint64_t &pipeNo);
+    void onTaskCompleteSuccess(DataFetcher &fetcher, const ndn::Data &data,
+                               const ndn::time::nanoseconds &rtt);
 
     /**
      * @brief Callback function when DataFetcher has a failure. The Pipeline
      * will stop processing new requests. The taks in Pipeline will be
      * completed, but the Consumer will exit with corresponding error code
      *
+     * @param fetcher The DataFetcher that failed
      */
-    void onTaskCompleteFailure();
+    void onTaskCompleteFailure(DataFetcher &fetcher);
+
+    /**
+     * @brief Callback function for when DataFetcher wants to express a hedged
+     * Interest
+     *
+     * @return true The hedge fits in the budget and has been counted
+     * @return false The hedge budget is spent or the Pipeline is stopped
+     */
+    bool onTaskHedge(DataFetcher &fetcher);
 
   private:
-    ndn::Face &m_face;
+    boost::asio::io_service &m_ioService;
     size_t m_size;
 
-    std::unordered_map<uint64_t, std::shared_ptr<DataFetcher>> m_window;
+    // Used by the Face thread only
+    SlotPool<DataFetcher> m_fetchers;
+    Request m_drained;
+
+    MpscRing<Request> m_requests;
+    std::atomic<bool> m_drainScheduled;
+    std::atomic<size_t> m_nInserting;
+
+    std::atomic<size_t> m_nReserved;
+    std::atomic<size_t> m_nWaiters;
     boost::condition_variable m_cvWindow;
     boost::mutex m_mtxWindow;
 
+    std::deque<std::function<void()>> m_slotWaiters;
+    std::atomic<size_t> m_nSlotWaiters;
+    boost::mutex m_mtxSlotWaiters;
+
     std::atomic<bool> m_stop;
-    std::atomic<uint64_t> m_pipeNo;
     std::atomic<uint64_t> m_nSegmentsReceived;
     std::atomic<uint64_t> m_nBytesReceived;
 
+    boost::mutex m_mtxStatistics;
     ndn::time::steady_clock::TimePoint m_startTime;
     ndn::time::duration<double, ndn::time::milliseconds::period> m_duration;
+    uint64_t m_nNacks;
+    uint64_t m_nTimeouts;
+    uint64_t m_nFailures;
+    LatencyHistogram m_latency;
+
+    // Used by the Face thread only
+    double m_srtt; // ms
+    double m_rate; // segments / ms
+    uint64_t m_nRateSamples;
+    ndn::time::steady_clock::TimePoint m_rateStartTime;
+    std::atomic<size_t> m_bdp; // segments
+
+    // Used by the Face thread only
+    const double m_hedgePercentile;
+    const double m_hedgeBudget; // hedged Interests / expressed Interests
+    LatencyHistogram m_recentLatency;
+    ndn::time::nanoseconds m_hedgeDelay;
+    uint64_t m_nFetched;
+    std::atomic<uint64_t> m_nHedges;
+    std::atomic<uint64_t> m_nHedgesWon;
 };
 } // namespace xrdndnconsumer
 
-#endif // XRDNDN_PIPELINE_HH
\ No newline at end of file
+#endif // XRDNDN_PIPELINE_HH
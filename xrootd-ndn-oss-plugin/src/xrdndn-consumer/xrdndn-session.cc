@@ -0,0 +1,105 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include "../common/xrdndn-logger.hh"
+#include "xrdndn-session.hh"
+
+using namespace ndn;
+
+namespace xrdndnconsumer {
+std::shared_ptr<Session> Session::getSession(const Options &opts) {
+    auto session = std::make_shared<Session>(opts);
+
+    if (!session || session->m_error) {
+        NDN_LOG_FATAL("Unable to get XRootD NDN Consumer session");
+        return nullptr;
+    }
+
+    return session;
+}
+
+std::shared_ptr<Session> Session::getSession(const Options &opts,
+                                             ndn::Face &face) {
+    auto session = std::make_shared<Session>(opts, face);
+
+    if (!session || session->m_error) {
+        NDN_LOG_FATAL("Unable to get XRootD NDN Consumer session");
+        return nullptr;
+    }
+
+    return session;
+}
+
+Session::Session(const Options &opts) : Session(opts, nullptr) {}
+
+Session::Session(const Options &opts, ndn::Face &face)
+    : Session(opts, &face) {}
+
+Session::Session(const Options &opts, ndn::Face *face)
+    : m_ownedFace(face ? nullptr : new ndn::Face()),
+      m_face(face ? *face : *m_ownedFace),
+      m_validator(security::v2::getAcceptAllValidator()),
+      m_timers(m_face.getIoService()), m_error(false), m_stopped(false) {
+    NDN_LOG_TRACE("Alloc XRootD NDN Consumer session");
+
+    m_pipeline =
+        std::make_shared<Pipeline>(m_face, m_validator, m_timers, opts);
+    if (!m_pipeline) {
+        m_error = true;
+        NDN_LOG_ERROR("Unable to get Pipeline object instance");
+        return;
+    }
+
+    processEvents(false);
+
+    if (!m_error) {
+        faceProcessEventsThread =
+            boost::thread(std::bind(&Session::processEvents, this, true));
+    }
+}
+
+Session::~Session() { stop(); }
+
+void Session::stop() {
+    if (m_stopped.exchange(true))
+        return;
+
+    m_face.removeAllPendingInterests();
+    m_face.shutdown();
+    if (faceProcessEventsThread.joinable())
+        faceProcessEventsThread.join();
+
+    // Face operations are confined to the event loop, thus the Pipeline is
+    // stopped only after the loop has finished
+    if (m_pipeline)
+        m_pipeline->stop();
+}
+
+void Session::processEvents(bool keepThread) {
+    try {
+        m_face.processEvents(time::milliseconds::zero(), keepThread);
+    } catch (const std::exception &e) {
+        NDN_LOG_ERROR("Catch exception: "
+                      << e.what() << " while processing NDN face events");
+        m_error = true;
+        m_pipeline->stop();
+    }
+}
+} // namespace xrdndnconsumer
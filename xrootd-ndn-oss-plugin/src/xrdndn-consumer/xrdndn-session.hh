@@ -0,0 +1,131 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_SESSION_HH
+#define XRDNDN_SESSION_HH
+
+#include <atomic>
+#include <memory>
+
+#include <ndn-cxx/face.hpp>
+#include <ndn-cxx/security/v2/validator.hpp>
+#include <ndn-cxx/security/validator-null.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include "xrdndn-consumer-options.hh"
+#include "xrdndn-pipeline.hh"
+#include "xrdndn-timer-wheel.hh"
+
+namespace xrdndnconsumer {
+/**
+ * @brief NDN session of the Consumer: the Face, its event processing thread,
+ * the timer wheel and the Pipeline. Every Consumer creates its own session by
+ * default, but many Consumers (e.g. one per file of a batch transfer) can
+ * share a single session and thus a single Face and Pipeline window
+ *
+ */
+class Session : public std::enable_shared_from_this<Session>,
+                private boost::noncopyable {
+  public:
+    /**
+     * @brief Returns a pointer to a Session object instance
+     *
+     * @param opts Consumer options. Only the Pipeline size is used
+     * @return std::shared_ptr<Session> If the Session is not able to connect
+     * to local forwarder it will return nullptr, else the Session instance
+     * will be returned
+     */
+    static std::shared_ptr<Session> getSession(const Options &opts);
+
+    /**
+     * @brief Returns a pointer to a Session object instance working over an
+     * existing Face (e.g. a DummyClientFace linked to an in-process Producer)
+     *
+     * @param opts Consumer options. Only the Pipeline size is used
+     * @param face The Face. It must outlive the Session
+     * @return std::shared_ptr<Session> nullptr on error, else the Session
+     * instance
+     */
+    static std::shared_ptr<Session> getSession(const Options &opts,
+                                               ndn::Face &face);
+
+    /**
+     * @brief Construct a new Session object over its own Face, connected to
+     * the local forwarder, and start processing Face events
+     *
+     * @param opts Consumer options
+     */
+    Session(const Options &opts);
+
+    /**
+     * @brief Construct a new Session object over an existing Face and start
+     * processing its events
+     *
+     * @param opts Consumer options
+     * @param face The Face. It must outlive the Session
+     */
+    Session(const Options &opts, ndn::Face &face);
+
+    /**
+     * @brief Destroy the Session object
+     *
+     */
+    ~Session();
+
+    /**
+     * @brief Stop processing Face events and stop the Pipeline. All
+     * outstanding requests are completed with -ECANCELED. Must not be called
+     * from the Face thread
+     *
+     */
+    void stop();
+
+    bool hasError() const { return m_error; }
+
+    Pipeline &getPipeline() { return *m_pipeline; }
+
+  private:
+    Session(const Options &opts, ndn::Face *face);
+
+    /**
+     * @brief Process Interests
+     *
+     * @param keepThread Keep thread in a blocked state (in event processing),
+     * even when there are no outstanding events (e.g., no Interest/Data is
+     * expected)
+     */
+    void processEvents(bool keepThread = true);
+
+  private:
+    std::unique_ptr<ndn::Face> m_ownedFace;
+    ndn::Face &m_face;
+    ndn::security::v2::Validator &m_validator;
+    TimerWheel m_timers;
+
+    boost::thread faceProcessEventsThread;
+
+    std::atomic<bool> m_error;
+    std::atomic<bool> m_stopped;
+    std::shared_ptr<Pipeline> m_pipeline;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_SESSION_HH
@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_SLOT_POOL_HH
+#define XRDNDN_SLOT_POOL_HH
+
+#include <deque>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace xrdndnconsumer {
+/**
+ * @brief Fixed capacity pool of reusable objects. All objects are constructed
+ * once, when the pool is created, and handed out and taken back through a free
+ * list, thus acquiring and releasing a slot never allocates memory. The number
+ * of slots in use is bounded by the capacity, which makes the pool a window
+ *
+ * @tparam T Type of the pooled objects
+ */
+template <typename T> class SlotPool : private boost::noncopyable {
+  public:
+    /**
+     * @brief Construct a new Slot Pool object
+     *
+     * @param capacity The number of slots
+     * @param args Arguments passed to the constructor of every slot. They are
+     * passed as lvalues, thus copied by each slot that takes them by value
+     */
+    template <typename... Args>
+    SlotPool(size_t capacity, Args &&... args) : m_stop(false) {
+        m_free.reserve(capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+            m_slots.emplace_back(args...);
+            m_free.push_back(&m_slots.back());
+        }
+    }
+
+    /**
+     * @brief Take a slot out of the pool. Blocks until a slot is released if
+     * all of them are in use
+     *
+     * @return T* The slot or nullptr if the pool is stopped
+     */
+    T *acquire() {
+        boost::unique_lock<boost::mutex> lock(m_mtx);
+        m_cv.wait(lock, [&]() { return !m_free.empty() || m_stop; });
+        return take();
+    }
+
+    /**
+     * @brief Take a slot out of the pool only if one is available right now
+     *
+     * @return T* The slot or nullptr if all slots are in use or the pool is
+     * stopped
+     */
+    T *tryAcquire() {
+        boost::lock_guard<boost::mutex> lock(m_mtx);
+        return take();
+    }
+
+    /**
+     * @brief Give a slot back to the pool
+     *
+     * @param slot The slot, previously acquired from this pool
+     * @return size_t The number of slots still in use
+     */
+    size_t release(T *slot) {
+        size_t inUse;
+        {
+            boost::lock_guard<boost::mutex> lock(m_mtx);
+            m_free.push_back(slot);
+            inUse = m_slots.size() - m_free.size();
+        }
+        m_cv.notify_one();
+        return inUse;
+    }
+
+    /**
+     * @brief Stop handing out slots and wake up all waiters
+     *
+     */
+    void stop() {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mtx);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+    }
+
+    /**
+     * @brief Get the number of slots in use
+     *
+     * @return size_t Number of slots acquired and not yet released
+     */
+    size_t inUse() {
+        boost::lock_guard<boost::mutex> lock(m_mtx);
+        return m_slots.size() - m_free.size();
+    }
+
+    /**
+     * @brief Call f for every slot of the pool, in use or not
+     *
+     */
+    template <typename F> void forEach(F f) {
+        for (auto &slot : m_slots)
+            f(slot);
+    }
+
+  private:
+    T *take() {
+        if (m_stop || m_free.empty())
+            return nullptr;
+
+        T *slot = m_free.back();
+        m_free.pop_back();
+        return slot;
+    }
+
+  private:
+    std::deque<T> m_slots;
+    std::vector<T *> m_free;
+
+    boost::mutex m_mtx;
+    boost::condition_variable m_cv;
+    bool m_stop;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_SLOT_POOL_HH
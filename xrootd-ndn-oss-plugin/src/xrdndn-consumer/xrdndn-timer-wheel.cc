@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#include <algorithm>
+
+#include "xrdndn-timer-wheel.hh"
+
+namespace xrdndnconsumer {
+const size_t TimerWheel::LEVEL0_BITS;
+const size_t TimerWheel::LEVELN_BITS;
+
+TimerWheel::TimerWheel(boost::asio::io_service &ioService,
+                       ndn::time::milliseconds tick)
+    : m_timer(ioService), m_tick(tick),
+      m_startTime(ndn::time::steady_clock::now()),
+      m_token(std::make_shared<char>()), m_now(0), m_nArmed(0),
+      m_running(false) {}
+
+TimerWheel::~TimerWheel() {
+    m_token.reset();
+    m_timer.cancel();
+
+    // Unlink all timers, so that their owners can be destroyed after the wheel
+    for (auto &slot : m_level0)
+        slot.clear();
+    for (auto &slot : m_level1)
+        slot.clear();
+    for (auto &slot : m_level2)
+        slot.clear();
+    m_expired.clear();
+}
+
+void TimerWheel::arm(Timer &timer, ndn::time::nanoseconds delay) {
+    if (timer.is_linked()) {
+        timer.unlink();
+        --m_nArmed;
+    }
+
+    if (!m_running && m_nArmed == 0)
+        m_now = getCurrentTick();
+
+    int64_t ticks = (delay.count() + m_tick.count() - 1) / m_tick.count();
+    timer.m_expires = m_now + std::max<int64_t>(ticks, 1);
+    insert(timer);
+    ++m_nArmed;
+
+    if (!m_running)
+        scheduleTick();
+}
+
+void TimerWheel::cancel(Timer &timer) {
+    if (timer.is_linked()) {
+        timer.unlink();
+        --m_nArmed;
+    }
+}
+
+size_t TimerWheel::size() { return m_nArmed; }
+
+void TimerWheel::insert(Timer &timer) {
+    const uint64_t maxTicks = (1ULL << (LEVEL0_BITS + 2 * LEVELN_BITS)) - 1;
+    const uint64_t level0Mask = (1ULL << LEVEL0_BITS) - 1;
+    const uint64_t levelNMask = (1ULL << LEVELN_BITS) - 1;
+
+    if (timer.m_expires < m_now)
+        timer.m_expires = m_now;
+    if (timer.m_expires - m_now > maxTicks)
+        timer.m_expires = m_now + maxTicks;
+
+    uint64_t delta = timer.m_expires - m_now;
+    if (delta < (1ULL << LEVEL0_BITS)) {
+        m_level0[timer.m_expires & level0Mask].push_back(timer);
+    } else if (delta < (1ULL << (LEVEL0_BITS + LEVELN_BITS))) {
+        m_level1[(timer.m_expires >> LEVEL0_BITS) & levelNMask].push_back(
+            timer);
+    } else {
+        m_level2[(timer.m_expires >> (LEVEL0_BITS + LEVELN_BITS)) & levelNMask]
+            .push_back(timer);
+    }
+}
+
+void TimerWheel::cascade(TimerList &slot) {
+    TimerList timers;
+    timers.splice(timers.end(), slot);
+
+    while (!timers.empty()) {
+        auto &timer = timers.front();
+        timers.pop_front();
+        insert(timer);
+    }
+}
+
+void TimerWheel::advance() {
+    const uint64_t levelNMask = (1ULL << LEVELN_BITS) - 1;
+    size_t index = m_now & ((1ULL << LEVEL0_BITS) - 1);
+
+    // At the start of each turn of a level, the next slot of the level above
+    // is spread over the levels below
+    if (index == 0) {
+        size_t index1 = (m_now >> LEVEL0_BITS) & levelNMask;
+        cascade(m_level1[index1]);
+
+        if (index1 == 0)
+            cascade(
+                m_level2[(m_now >> (LEVEL0_BITS + LEVELN_BITS)) & levelNMask]);
+    }
+
+    m_expired.splice(m_expired.end(), m_level0[index]);
+    ++m_now;
+}
+
+uint64_t TimerWheel::getCurrentTick() const {
+    auto elapsed = ndn::time::duration_cast<ndn::time::nanoseconds>(
+        ndn::time::steady_clock::now() - m_startTime);
+    return elapsed.count() / m_tick.count();
+}
+
+void TimerWheel::scheduleTick() {
+    m_running = true;
+    m_timer.expires_from_now(std::chrono::nanoseconds(m_tick.count()));
+    m_timer.async_wait([this, token = std::weak_ptr<char>(m_token)](
+                           const boost::system::error_code &error) {
+        if (!token.expired())
+            onTick(error);
+    });
+}
+
+void TimerWheel::onTick(const boost::system::error_code &error) {
+    if (error == boost::asio::error::operation_aborted)
+        return;
+
+    uint64_t currentTick = getCurrentTick();
+    while (m_now < currentTick) {
+        if (m_nArmed == 0) {
+            m_now = currentTick;
+            break;
+        }
+        advance();
+    }
+
+    // Callbacks may arm or cancel timers, the expired list included
+    while (!m_expired.empty()) {
+        auto &timer = m_expired.front();
+        m_expired.pop_front();
+        --m_nArmed;
+        timer.m_callback();
+    }
+
+    m_running = false;
+    if (m_nArmed > 0)
+        scheduleTick();
+}
+} // namespace xrdndnconsumer
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Named Data Networking plugin for xrootd                                    *
+ * Copyright © 2019 California Institute of Technology                        *
+ *                                                                            *
+ * Author: Catalin Iordache <catalin.iordache@cern.ch>                        *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation, either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
+ *****************************************************************************/
+
+#ifndef XRDNDN_TIMER_WHEEL_HH
+#define XRDNDN_TIMER_WHEEL_HH
+
+#include <array>
+#include <functional>
+#include <memory>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/intrusive/list.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <ndn-cxx/util/time.hpp>
+
+namespace xrdndnconsumer {
+/**
+ * @brief Hierarchical timer wheel shared by all DataFetchers of one Consumer
+ * event loop. It is used for retransmission and congestion backoff timers.
+ * Timers are intrusive, so arming and canceling a timer is O(1) and does not
+ * allocate memory. One io_service timer drives the wheel, and only while
+ * there are armed timers.
+ *
+ * The wheel is not thread safe and takes no lock: timers are armed and
+ * canceled by DataFetchers, which run on the event loop thread only, or after
+ * the event loop has stopped
+ *
+ */
+class TimerWheel : private boost::noncopyable {
+    using Hook = boost::intrusive::list_base_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+
+  public:
+    /**
+     * @brief Timer owned by the user of the wheel. The callback is set once and
+     * called from the event loop thread every time the timer expires
+     *
+     */
+    class Timer : public Hook {
+      public:
+        explicit Timer(std::function<void()> callback)
+            : m_callback(std::move(callback)), m_expires(0) {}
+
+      private:
+        friend class TimerWheel;
+
+        std::function<void()> m_callback;
+        uint64_t m_expires; // ticks
+    };
+
+    /**
+     * @brief Construct a new Timer Wheel object
+     *
+     * @param ioService The io_service of the event loop
+     * @param tick The resolution of the wheel
+     */
+    TimerWheel(boost::asio::io_service &ioService,
+               ndn::time::milliseconds tick = ndn::time::milliseconds(1));
+
+    /**
+     * @brief Destroy the Timer Wheel object
+     *
+     */
+    ~TimerWheel();
+
+    /**
+     * @brief Arm a timer. If the timer is already armed, it is rescheduled
+     *
+     * @param timer The timer
+     * @param delay The time after which the timer callback is called. Rounded
+     * up to the wheel resolution and capped to the range of the wheel
+     */
+    void arm(Timer &timer, ndn::time::nanoseconds delay);
+
+    /**
+     * @brief Cancel a timer. Nothing happens if the timer is not armed
+     *
+     * @param timer The timer
+     */
+    void cancel(Timer &timer);
+
+    /**
+     * @brief Get the number of armed timers
+     *
+     * @return size_t Number of armed timers
+     */
+    size_t size();
+
+  private:
+    using TimerList = boost::intrusive::list<
+        Timer, boost::intrusive::constant_time_size<false>>;
+
+    /**
+     * @brief Put an unlinked timer in the slot of its expiration tick
+     *
+     */
+    void insert(Timer &timer);
+
+    /**
+     * @brief Move the timers of a slot from a higher level to lower levels
+     *
+     */
+    void cascade(TimerList &slot);
+
+    /**
+     * @brief Process one tick, moving expired timers in the expired list
+     *
+     */
+    void advance();
+
+    /**
+     * @brief Number of ticks elapsed since the wheel was created
+     *
+     */
+    uint64_t getCurrentTick() const;
+
+    /**
+     * @brief Schedule the io_service timer for the next tick
+     *
+     */
+    void scheduleTick();
+
+    /**
+     * @brief io_service timer handler. Catches up with the current time and
+     * calls the callbacks of expired timers
+     *
+     */
+    void onTick(const boost::system::error_code &error);
+
+  private:
+    /**
+     * @brief The first level has one slot per tick. Each of the two upper
+     * levels has slots as long as a whole turn of the level below. With 1 ms
+     * ticks the wheel spans 256 ms, 16 s and 17 min
+     *
+     */
+    static const size_t LEVEL0_BITS = 8;
+    static const size_t LEVELN_BITS = 6;
+
+    boost::asio::steady_timer m_timer;
+    const ndn::time::nanoseconds m_tick;
+    const ndn::time::steady_clock::TimePoint m_startTime;
+
+    // Expires with the wheel. A tick handler already queued when the wheel is
+    // destroyed sees it expired and does not touch the wheel
+    std::shared_ptr<char> m_token;
+
+    std::array<TimerList, 1 << LEVEL0_BITS> m_level0;
+    std::array<TimerList, 1 << LEVELN_BITS> m_level1;
+    std::array<TimerList, 1 << LEVELN_BITS> m_level2;
+    TimerList m_expired;
+
+    uint64_t m_now; // ticks
+    size_t m_nArmed;
+    bool m_running;
+};
+} // namespace xrdndnconsumer
+
+#endif // XRDNDN_TIMER_WHEEL_HH
@@ -18,6 +18,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
  *****************************************************************************/
 
+#include <algorithm>
 #include <array>
 
 #include <errno.h>
@@ -27,23 +28,47 @@
 #include <unistd.h>
 
 #include "../common/xrdndn-logger.hh"
+#include "../common/xrdndn-synthetic.hh"
 #include "../common/xrdndn-utils.hh"
 #include "xrdndn-file-handler.hh"
 
 using namespace ndn;
 
 namespace xrdndnproducer {
+static uint64_t getFileVersion(const struct stat &info) {
+    // A file replaced within the granularity of its modification time still
+    // gets a new inode or size
+    uint64_t version = 14695981039346656037ULL;
+    for (uint64_t field :
+         {static_cast<uint64_t>(info.st_mtim.tv_sec),
+          static_cast<uint64_t>(info.st_mtim.tv_nsec),
+          static_cast<uint64_t>(info.st_ino),
+          static_cast<uint64_t>(info.st_size)}) {
+        version ^= field;
+        version *= 1099511628211ULL;
+    }
+    return version;
+}
+
 std::shared_ptr<FileHandler>
 FileHandler::getFileHandler(const std::string path,
-                            const std::shared_ptr<Packager> &packager) {
-    auto fh = std::make_shared<FileHandler>(path, packager);
+                            const std::shared_ptr<Packager> &packager,
+                            bool synthetic) {
+    auto fh = std::make_shared<FileHandler>(path, packager, synthetic);
     return fh;
 }
 
 FileHandler::FileHandler(const std::string path,
-                         const std::shared_ptr<Packager> &packager)
-    : m_fd(XRDNDN_EFAILURE), m_path(path), m_packager(packager) {
+                         const std::shared_ptr<Packager> &packager,
+                         bool synthetic)
+    : m_fd(XRDNDN_EFAILURE), m_path(path), m_packager(packager),
+      m_isSynthetic(false), m_syntheticSize(0), m_syntheticSeed(0),
+      m_version(0), m_fileSize(-1) {
     accessTime = boost::posix_time::second_clock::local_time();
+
+    if (synthetic)
+        m_isSynthetic = xrdndn::Synthetic::parsePath(m_path, m_syntheticSize,
+                                                     m_syntheticSeed);
     Open();
 }
 
@@ -57,6 +82,8 @@ FileHandler::~FileHandler() {
 
 boost::posix_time::ptime FileHandler::getAccessTime() { return accessTime; }
 
+uint64_t FileHandler::getVersion() const { return m_version; }
+
 /*****************************************************************************/
 /*                                  O p e n                                  */
 /*****************************************************************************/
@@ -68,6 +95,11 @@ std::shared_ptr<ndn::Data> FileHandler::getOpenData(ndn::Name &name) {
 }
 
 int FileHandler::Open() {
+    if (m_isSynthetic) {
+        updateVersion();
+        return XRDNDN_ESUCCESS;
+    }
+
     if (isOpened()) {
         NDN_LOG_INFO("File: " << m_path << " already opened");
         return XRDNDN_ESUCCESS;
@@ -81,10 +113,29 @@ int FileHandler::Open() {
         return -errno;
     }
 
+    updateVersion();
     return XRDNDN_ESUCCESS;
 }
 
-bool FileHandler::isOpened() { return m_fd == XRDNDN_EFAILURE ? false : true; }
+void FileHandler::updateVersion() {
+    if (m_isSynthetic) {
+        m_version = m_syntheticSeed;
+        m_fileSize = m_syntheticSize;
+        return;
+    }
+
+    // Taken from the opened file, which is the one actually read even if the
+    // path has been replaced meanwhile
+    struct stat info;
+    if (fstat(m_fd, &info) == XRDNDN_ESUCCESS) {
+        m_version = getFileVersion(info);
+        m_fileSize = info.st_size;
+    }
+}
+
+bool FileHandler::isOpened() {
+    return m_isSynthetic || m_fd != XRDNDN_EFAILURE;
+}
 
 /*****************************************************************************/
 /*                                F s t a t                                  */
@@ -105,20 +156,30 @@ std::shared_ptr<ndn::Data> FileHandler::getFstatData(ndn::Name &name) {
 int FileHandler::Fstat(void *buff) {
     NDN_LOG_INFO("Fstat file: " << m_path);
 
-    if (stat(m_path.c_str(), static_cast<struct stat *>(buff)) ==
-        XRDNDN_EFAILURE) {
+    // The buffer may not be aligned for struct stat, thus it is only copied
+    struct stat info;
+    if (m_isSynthetic) {
+        memset(&info, 0, sizeof(struct stat));
+        info.st_mode = S_IFREG | 0444;
+        info.st_nlink = 1;
+        info.st_size = m_syntheticSize;
+        info.st_blksize = XRDNDN_MAX_NDN_PACKET_SIZE;
+        info.st_blocks = (m_syntheticSize + 511) / 512;
+    } else if (stat(m_path.c_str(), &info) == XRDNDN_EFAILURE) {
         NDN_LOG_WARN("Failed to fstat file: " << m_path << ": "
                                               << strerror(errno));
         return -errno;
     }
 
+    memcpy(buff, &info, sizeof(struct stat));
     return XRDNDN_ESUCCESS;
 }
 
 /*****************************************************************************/
 /*                                  R e a d                                  */
 /*****************************************************************************/
-std::shared_ptr<ndn::Data> FileHandler::getReadData(ndn::Name &name) {
+std::shared_ptr<ndn::Data> FileHandler::getReadData(ndn::Name &name,
+                                                    bool versioned) {
     accessTime = boost::posix_time::second_clock::local_time();
 
     std::array<uint8_t, XRDNDN_MAX_NDN_PACKET_SIZE> blockFromFile;
@@ -129,11 +190,28 @@ std::shared_ptr<ndn::Data> FileHandler::getReadData(ndn::Name &name) {
     if (retRead < 0) {
         return m_packager->getPackage(name, retRead);
     } else {
-        return m_packager->getPackage(name, blockFromFile.data(), retRead);
+        // An empty file still has segment 0, with no content
+        int64_t fileSize = m_fileSize;
+        int64_t finalSegmentNo =
+            fileSize < 0 ? -1
+                         : std::max<int64_t>(fileSize - 1, 0) /
+                               XRDNDN_MAX_NDN_PACKET_SIZE;
+        return m_packager->getPackage(name, blockFromFile.data(), retRead,
+                                      versioned, finalSegmentNo);
     }
 }
 
 ssize_t FileHandler::Read(void *buff, size_t count, off_t offset) {
+    if (m_isSynthetic) {
+        if (static_cast<uint64_t>(offset) >= m_syntheticSize)
+            return 0;
+
+        count = std::min<uint64_t>(count, m_syntheticSize - offset);
+        xrdndn::Synthetic::fill(static_cast<uint8_t *>(buff), count, offset,
+                                m_syntheticSeed);
+        return count;
+    }
+
     auto ret = pread(m_fd, buff, count, offset);
     if (ret == XRDNDN_EFAILURE) {
         NDN_LOG_WARN("Failed to read " << count << " bytes" << m_path << " @"
@@ -144,4 +222,57 @@ ssize_t FileHandler::Read(void *buff, size_t count, off_t offset) {
 
     return ret;
 }
+
+/*****************************************************************************/
+/*                             O p e n S t a t                               */
+/*****************************************************************************/
+std::shared_ptr<ndn::Data>
+FileHandler::getOpenStatData(ndn::Name &name, uint64_t inlineFileSize,
+                             const std::function<ndn::Name()> &getHandle) {
+    accessTime = boost::posix_time::second_clock::local_time();
+
+    auto retOpen = Open();
+    if (retOpen != XRDNDN_ESUCCESS) {
+        return m_packager->getPackage(name, retOpen);
+    }
+
+    // Files are expected not to change. One modified in place is noticed here
+    // and reads of its previous version are refused from now on
+    updateVersion();
+
+    // A failed stat or read only drops the element; the consumer falls back
+    // to the separate fstat and read Interests for whatever is missing.
+    ndn::Block content(ndn::tlv::Content);
+
+    auto handle = getHandle();
+    if (!handle.empty()) {
+        const auto &wire = handle.wireEncode();
+        content.push_back(
+            makeBinaryBlock(XRDNDN_TLV_FILE_HANDLE, wire.wire(), wire.size()));
+    }
+
+    content.push_back(
+        makeNonNegativeIntegerBlock(XRDNDN_TLV_FILE_VERSION, m_version));
+
+    struct stat info;
+    if (Fstat(&info) == XRDNDN_ESUCCESS) {
+        content.push_back(makeBinaryBlock(
+            XRDNDN_TLV_STAT, reinterpret_cast<const uint8_t *>(&info),
+            sizeof(info)));
+
+        // Only segment 0 fits next to the stat in a single Data packet
+        if (info.st_size > 0 &&
+            static_cast<uint64_t>(info.st_size) <= inlineFileSize) {
+            std::array<uint8_t, XRDNDN_MAX_NDN_PACKET_SIZE> blockFromFile;
+            auto retRead = Read(&blockFromFile, XRDNDN_MAX_NDN_PACKET_SIZE, 0);
+            if (retRead > 0) {
+                content.push_back(makeBinaryBlock(
+                    XRDNDN_TLV_SEGMENT, blockFromFile.data(), retRead));
+            }
+        }
+    }
+
+    content.encode();
+    return m_packager->getPackage(name, content);
+}
 } // namespace xrdndnproducer
@@ -21,6 +21,9 @@
 #ifndef XRDNDN_FILE_HANDLER
 #define XRDNDN_FILE_HANDLER
 
+#include <atomic>
+#include <functional>
+
 #include <ndn-cxx/face.hpp>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -33,23 +36,65 @@ class FileHandler : public std::enable_shared_from_this<FileHandler> {
   public:
     static std::shared_ptr<FileHandler>
     getFileHandler(const std::string path,
-                   const std::shared_ptr<Packager> &packager);
+                   const std::shared_ptr<Packager> &packager,
+                   bool synthetic = false);
 
+    /**
+     * @brief Construct a new File Handler object
+     *
+     * @param path The file path
+     * @param packager Packager of all Data sent for this file
+     * @param synthetic Serve the generated content of a virtual file if path
+     * is a synthetic file path, instead of opening it
+     */
     FileHandler(const std::string path,
-                const std::shared_ptr<Packager> &packager);
+                const std::shared_ptr<Packager> &packager,
+                bool synthetic = false);
     ~FileHandler();
 
     std::shared_ptr<ndn::Data> getOpenData(ndn::Name &name);
     std::shared_ptr<ndn::Data> getFstatData(ndn::Name &name);
-    std::shared_ptr<ndn::Data> getReadData(ndn::Name &name);
+    /**
+     * @brief Get a segment of the file
+     *
+     * @param name The Interest Name
+     * @param versioned The Name identifies the file version, thus the Data
+     * never changes and gets the long freshness period
+     */
+    std::shared_ptr<ndn::Data> getReadData(ndn::Name &name,
+                                           bool versioned = false);
+    /**
+     * @brief Get the reply to a combined open Interest
+     *
+     * @param name The Interest Name
+     * @param inlineFileSize Files up to this size get their first segment
+     * inlined
+     * @param getHandle Returns the file handle Name sent to the Consumer, or
+     * an empty Name if file handles are disabled. Only called once the file
+     * is opened and its version refreshed, so that the handle records the
+     * current version and none is assigned if the open fails
+     */
+    std::shared_ptr<ndn::Data>
+    getOpenStatData(ndn::Name &name, uint64_t inlineFileSize,
+                    const std::function<ndn::Name()> &getHandle);
 
     bool isOpened();
     boost::posix_time::ptime getAccessTime();
 
+    /**
+     * @brief Get the version of the file, derived from its modification time,
+     * inode and size when it was last opened or stat-ed by a combined open.
+     * The file size read at the same time tells the last segment number sent
+     * as FinalBlockId of read Data
+     *
+     */
+    uint64_t getVersion() const;
+
   private:
     int Open();
     int Fstat(void *buff);
     ssize_t Read(void *buff, size_t count, off_t offset);
+    void updateVersion();
 
   private:
     boost::posix_time::ptime accessTime;
@@ -57,6 +102,14 @@ class FileHandler : public std::enable_shared_from_this<FileHandler> {
     int m_fd;
     const std::string m_path;
     const std::shared_ptr<Packager> m_packager;
+
+    bool m_isSynthetic;
+    uint64_t m_syntheticSize;
+    uint64_t m_syntheticSeed;
+
+    std::atomic<uint64_t> m_version;
+    // Set with the version. Negative if unknown
+    std::atomic<int64_t> m_fileSize;
 };
 } // namespace xrdndnproducer
 
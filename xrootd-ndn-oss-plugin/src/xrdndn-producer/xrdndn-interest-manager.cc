@@ -18,6 +18,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.     *
  *****************************************************************************/
 
+#include <errno.h>
+#include <random>
+
 #include "../common/xrdndn-logger.hh"
 #include "../common/xrdndn-namespace.hh"
 #include "../common/xrdndn-utils.hh"
@@ -27,11 +30,19 @@
 using namespace ndn;
 
 namespace xrdndnproducer {
+static uint64_t getHandleVersion() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
 InterestManager::InterestManager(const Options &opts,
                                  onDataCallback dataCallback)
-    : m_ioServiceWork(m_ioService), m_options(opts) {
+    : m_ioServiceWork(m_ioService), m_options(opts),
+      m_fileHandles(opts.nFileHandles), m_nextHandleId(1),
+      m_handleVersion(getHandleVersion()) {
     m_onDataCallback = std::move(dataCallback);
     m_packager = std::make_shared<Packager>(m_options.freshnessPeriod,
+                                            m_options.versionedFreshnessPeriod,
                                             m_options.disableSigning);
 
     for (size_t i = 0; i < m_options.nthreads; ++i) {
@@ -56,22 +67,112 @@ InterestManager::~InterestManager() {
     m_threads.join_all();
 }
 
-std::shared_ptr<FileHandler> InterestManager::getFileHandler(std::string path) {
-    auto it = m_FileHandlers.find(path);
-    if (it != m_FileHandlers.end()) {
-        return it->second->shared_from_this();
+std::shared_ptr<FileHandler>
+InterestManager::getFileHandler(const ndn::Name &name) {
+    // Lookups only hash and compare Name components in place. The file path
+    // string is built once, when the file is first requested
+    size_t hash = xrdndn::Utils::getFileHash(name);
+    {
+        boost::shared_lock<boost::shared_mutex> lock(m_FileHandlersMtx);
+        auto entry = findFileEntry(hash, name);
+        if (entry)
+            return entry->fileHandler;
     }
 
-    auto fh = FileHandler::getFileHandler(path, m_packager->shared_from_this());
+    std::string path = xrdndn::Utils::getPath(name);
+    if (path.empty())
+        return std::shared_ptr<FileHandler>(nullptr);
+
+    boost::unique_lock<boost::shared_mutex> lock(m_FileHandlersMtx);
+    // Another thread may have added it meanwhile
+    auto entry = findFileEntry(hash, name);
+    if (entry)
+        return entry->fileHandler;
+
+    auto fh = FileHandler::getFileHandler(path, m_packager->shared_from_this(),
+                                          m_options.synthetic);
     if (!fh) {
         NDN_LOG_WARN("Unable to get FileHandler object for file: " << path);
         return std::shared_ptr<FileHandler>(nullptr);
     }
 
+    m_FileHandlers.emplace(hash, FileEntry{name, fh, 0});
+    return fh;
+}
+
+std::shared_ptr<FileHandler> InterestManager::getFileHandler(uint64_t id,
+                                                             uint64_t version) {
+    if (version != m_handleVersion || id == 0 || m_fileHandles.empty())
+        return std::shared_ptr<FileHandler>(nullptr);
+
+    auto &handle = m_fileHandles[id % m_fileHandles.size()];
+    ndn::Name name;
+    uint64_t fileVersion;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(m_FileHandlersMtx);
+        if (handle.id != id)
+            return std::shared_ptr<FileHandler>(nullptr);
+
+        fileVersion = handle.fileVersion;
+        auto fh = handle.fileHandler.lock();
+        if (fh)
+            return fh->getVersion() == fileVersion ? fh : nullptr;
+        name = handle.name;
+    }
+
+    // The garbage collector released the FileHandler since the handle was
+    // assigned
+    auto fh = getFileHandler(name);
+    if (!fh || fh->getVersion() != fileVersion)
+        return std::shared_ptr<FileHandler>(nullptr);
+
     boost::unique_lock<boost::shared_mutex> lock(m_FileHandlersMtx);
-    m_FileHandlers[path] = fh;
+    if (handle.id == id)
+        handle.fileHandler = fh;
+    return fh;
+}
+
+ndn::Name
+InterestManager::getFileHandleName(const ndn::Name &name,
+                                   const std::shared_ptr<FileHandler> &fh) {
+    if (m_fileHandles.empty())
+        return ndn::Name();
 
-    return m_FileHandlers[path]->shared_from_this();
+    size_t hash = xrdndn::Utils::getFileHash(name);
+    boost::unique_lock<boost::shared_mutex> lock(m_FileHandlersMtx);
+
+    // The FileHandler may have been released meanwhile, then the handle is
+    // kept in the handle table only
+    auto entry = findFileEntry(hash, name);
+    if (entry && entry->handleId != 0) {
+        const auto &handle =
+            m_fileHandles[entry->handleId % m_fileHandles.size()];
+        if (handle.id == entry->handleId &&
+            handle.fileVersion == fh->getVersion())
+            return xrdndn::Utils::getFileHandleName(entry->handleId,
+                                                    m_handleVersion);
+    }
+
+    auto id = m_nextHandleId++;
+    auto &handle = m_fileHandles[id % m_fileHandles.size()];
+    handle.id = id;
+    handle.fileVersion = fh->getVersion();
+    handle.name = name;
+    handle.fileHandler = fh;
+    if (entry)
+        entry->handleId = id;
+
+    return xrdndn::Utils::getFileHandleName(id, m_handleVersion);
+}
+
+InterestManager::FileEntry *
+InterestManager::findFileEntry(size_t hash, const ndn::Name &name) {
+    auto range = m_FileHandlers.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (xrdndn::Utils::isSameFile(it->second.name, name))
+            return &it->second;
+    }
+    return nullptr;
 }
 
 void InterestManager::onGarbageCollector() {
@@ -81,11 +182,12 @@ void InterestManager::onGarbageCollector() {
     auto gbt = boost::posix_time::second_clock::local_time();
 
     for (auto it = m_FileHandlers.begin(); it != m_FileHandlers.end();) {
-        auto tdiff = (gbt - it->second->getAccessTime()).total_seconds();
+        auto tdiff =
+            (gbt - it->second.fileHandler->getAccessTime()).total_seconds();
 
         if (tdiff > m_options.gbFileLifeTime) {
             NDN_LOG_INFO("Garbage collector will erase map entry for file: "
-                         << it->first);
+                         << it->second.name);
             it = m_FileHandlers.erase(it);
         } else
             ++it;
@@ -97,14 +199,8 @@ void InterestManager::onGarbageCollector() {
 }
 
 void InterestManager::openInterest(const Interest &interest) {
-    m_ioService.post([&] {
-        Name name = interest.getName();
-
-        std::string path = xrdndn::Utils::getPath(name);
-        if (path.empty())
-            return;
-
-        auto fh = getFileHandler(path);
+    m_ioService.post([this, name = interest.getName()]() mutable {
+        auto fh = getFileHandler(name);
         auto data = fh ? fh->getOpenData(name)
                        : m_packager->getPackage(name, XRDNDN_EFAILURE);
 
@@ -113,14 +209,8 @@ void InterestManager::openInterest(const Interest &interest) {
 }
 
 void InterestManager::fstatInterest(const Interest &interest) {
-    m_ioService.post([&] {
-        Name name = interest.getName();
-
-        std::string path = xrdndn::Utils::getPath(name);
-        if (path.empty())
-            return;
-
-        auto fh = getFileHandler(path);
+    m_ioService.post([this, name = interest.getName()]() mutable {
+        auto fh = getFileHandler(name);
         auto data = fh ? fh->getFstatData(name)
                        : m_packager->getPackage(name, XRDNDN_EFAILURE);
 
@@ -129,15 +219,42 @@ void InterestManager::fstatInterest(const Interest &interest) {
 }
 
 void InterestManager::readInterest(const Interest &interest) {
-    m_ioService.post([&] {
-        Name name = interest.getName();
+    m_ioService.post([this, name = interest.getName()]() mutable {
+        std::shared_ptr<FileHandler> fh;
+        int errcode = XRDNDN_EFAILURE;
+        bool versioned = false;
+
+        // On -ESTALE the Consumer opens the file again to get a new handle or
+        // file version
+        uint64_t id, version;
+        if (xrdndn::Utils::getFileHandle(name, id, version)) {
+            fh = getFileHandler(id, version);
+            errcode = -ESTALE;
+            versioned = true;
+        } else {
+            fh = getFileHandler(name);
+            if (xrdndn::Utils::getFileVersion(name, version)) {
+                versioned = true;
+                if (fh && fh->getVersion() != version) {
+                    fh.reset();
+                    errcode = -ESTALE;
+                }
+            }
+        }
 
-        std::string path = xrdndn::Utils::getPath(name);
-        if (path.empty())
-            return;
+        auto data = fh ? fh->getReadData(name, versioned)
+                       : m_packager->getPackage(name, errcode);
+
+        m_onDataCallback(data);
+    });
+}
 
-        auto fh = getFileHandler(path);
-        auto data = fh ? fh->getReadData(name)
+void InterestManager::openStatInterest(const Interest &interest) {
+    m_ioService.post([this, name = interest.getName()]() mutable {
+        auto fh = getFileHandler(name);
+        auto getHandle = [&]() { return getFileHandleName(name, fh); };
+        auto data = fh ? fh->getOpenStatData(name, m_options.inlineFileSize,
+                                             getHandle)
                        : m_packager->getPackage(name, XRDNDN_EFAILURE);
 
         m_onDataCallback(data);
@@ -22,6 +22,7 @@
 #define XRDNDN_INTEREST_MANAGER_HH
 
 #include <unordered_map>
+#include <vector>
 
 #include <ndn-cxx/face.hpp>
 
@@ -46,9 +47,67 @@ class InterestManager {
     void openInterest(const ndn::Interest &interest);
     void fstatInterest(const ndn::Interest &interest);
     void readInterest(const ndn::Interest &interest);
+    void openStatInterest(const ndn::Interest &interest);
 
   private:
-    std::shared_ptr<FileHandler> getFileHandler(std::string path);
+    /**
+     * @brief A FileHandler and the Name of the Interest that opened it, used
+     * to tell apart files whose Names have the same hash
+     *
+     */
+    struct FileEntry {
+        ndn::Name name;
+        std::shared_ptr<FileHandler> fileHandler;
+        // Number of the file handle assigned to the file. 0 if none
+        uint64_t handleId;
+    };
+
+    /**
+     * @brief File handle table entry. The table is a ring indexed by handle
+     * number, so a handle is resolved with a single array lookup. The entry
+     * outlives the FileHandler, which is created again from the file Name if
+     * the garbage collector released it. A handle refers to one version of
+     * the file, thus the Data named by it never changes
+     *
+     */
+    struct HandleEntry {
+        uint64_t id = 0;
+        uint64_t fileVersion = 0;
+        ndn::Name name;
+        std::weak_ptr<FileHandler> fileHandler;
+    };
+
+    /**
+     * @brief Get the FileHandler of the file an Interest Name refers to,
+     * creating it on first use
+     *
+     */
+    std::shared_ptr<FileHandler> getFileHandler(const ndn::Name &name);
+
+    /**
+     * @brief Get the FileHandler of a file handle
+     *
+     * @return std::shared_ptr<FileHandler> nullptr if the handle is unknown,
+     * was reused, was assigned by another Producer instance or the file
+     * changed since
+     */
+    std::shared_ptr<FileHandler> getFileHandler(uint64_t id, uint64_t version);
+
+    /**
+     * @brief Get the handle of a file, assigning one if the file has none
+     * yet, its handle was reused or the file changed
+     *
+     * @return ndn::Name The handle Name. Empty if file handles are disabled
+     */
+    ndn::Name getFileHandleName(const ndn::Name &name,
+                                const std::shared_ptr<FileHandler> &fh);
+
+    /**
+     * @brief Find an existing file entry. The FileHandlers mutex must be held
+     * by the caller
+     *
+     */
+    FileEntry *findFileEntry(size_t hash, const ndn::Name &name);
     void onGarbageCollector();
 
   private:
@@ -62,8 +121,13 @@ class InterestManager {
     std::shared_ptr<boost::asio::system_timer> m_garbageCollectorTimer;
     const Options m_options;
 
-    std::unordered_map<std::string, std::shared_ptr<FileHandler>>
-        m_FileHandlers;
+    // Keyed by the hash of the file components of Names
+    std::unordered_multimap<size_t, FileEntry> m_FileHandlers;
+    // Guarded by the FileHandlers mutex as well
+    std::vector<HandleEntry> m_fileHandles;
+    uint64_t m_nextHandleId;
+    // Tells apart handles of other Producer instances, e.g. before a restart
+    const uint64_t m_handleVersion;
     mutable boost::shared_mutex m_FileHandlersMtx;
 };
 } // namespace xrdndnproducer
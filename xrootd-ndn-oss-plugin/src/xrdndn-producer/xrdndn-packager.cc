@@ -34,8 +34,11 @@ const security::SigningInfo Packager::signingInfo =
 const std::shared_ptr<ndn::KeyChain> Packager::keyChain =
     std::make_shared<KeyChain>();
 
-Packager::Packager(uint64_t freshnessPeriod, bool disableSignature)
-    : m_freshnessPeriod(freshnessPeriod), m_disableSigning(disableSignature) {
+Packager::Packager(uint64_t freshnessPeriod, uint64_t versionedFreshnessPeriod,
+                   bool disableSignature)
+    : m_freshnessPeriod(freshnessPeriod),
+      m_versionedFreshnessPeriod(versionedFreshnessPeriod),
+      m_disableSigning(disableSignature) {
     if (disableSignature) {
         SignatureInfo sigInfo =
             SignatureInfo(static_cast<ndn::tlv::SignatureTypeValue>(255));
@@ -46,8 +49,15 @@ Packager::Packager(uint64_t freshnessPeriod, bool disableSignature)
 
 Packager::~Packager() {}
 
-void Packager::digest(std::shared_ptr<ndn::Data> data) {
-    data->setFreshnessPeriod(m_freshnessPeriod);
+void Packager::digest(std::shared_ptr<ndn::Data> data, bool versioned) {
+    // Application level NACKs report errors that may be transient (e.g. a
+    // stale file handle). They are stale right away so that caches do not
+    // keep answering with them
+    if (data->getContentType() == tlv::ContentTypeValue::ContentType_Nack)
+        data->setFreshnessPeriod(time::milliseconds::zero());
+    else
+        data->setFreshnessPeriod(versioned ? m_versionedFreshnessPeriod
+                                           : m_freshnessPeriod);
 
     if (!m_disableSigning) {
         keyChain->sign(*data, signingInfo);
@@ -70,10 +80,22 @@ std::shared_ptr<ndn::Data> Packager::getPackage(ndn::Name &name,
 }
 
 std::shared_ptr<ndn::Data>
-Packager::getPackage(ndn::Name &name, const uint8_t *value, ssize_t size) {
+Packager::getPackage(ndn::Name &name, const uint8_t *value, ssize_t size,
+                     bool versioned, int64_t finalSegmentNo) {
     auto data = std::make_shared<ndn::Data>(name);
 
     data->setContent(value, size);
+    if (finalSegmentNo >= 0)
+        data->setFinalBlock(name::Component::fromSegment(finalSegmentNo));
+    digest(data->shared_from_this(), versioned);
+    return data->shared_from_this();
+}
+
+std::shared_ptr<ndn::Data> Packager::getPackage(ndn::Name &name,
+                                                const ndn::Block &content) {
+    auto data = std::make_shared<ndn::Data>(name);
+
+    data->setContent(content);
     digest(data->shared_from_this());
     return data->shared_from_this();
 }
@@ -29,19 +29,42 @@ class Packager : public std::enable_shared_from_this<Packager> {
     static const std::shared_ptr<ndn::KeyChain> keyChain;
 
   public:
-    Packager(uint64_t freshnessPeriod, bool disableSignature = false);
+    /**
+     * @brief Construct a new Packager object
+     *
+     * @param freshnessPeriod Freshness period in milliseconds of Data
+     * @param versionedFreshnessPeriod Freshness period in milliseconds of
+     * file segments whose Name carries the file version, which never change
+     * @param disableSignature Use a fake signature instead of SHA-256
+     */
+    Packager(uint64_t freshnessPeriod, uint64_t versionedFreshnessPeriod,
+             bool disableSignature = false);
     ~Packager();
 
     std::shared_ptr<ndn::Data> getPackage(ndn::Name &name,
                                           const int contentValue);
+    /**
+     * @brief Get a Data packet carrying a file segment
+     *
+     * @param name The Data Name
+     * @param value The segment content
+     * @param size The segment size
+     * @param versioned The Name identifies the file version
+     * @param finalSegmentNo The last segment number of the file, set as
+     * FinalBlockId. Negative if unknown
+     */
     std::shared_ptr<ndn::Data> getPackage(ndn::Name &name, const uint8_t *value,
-                                          ssize_t size);
+                                          ssize_t size, bool versioned = false,
+                                          int64_t finalSegmentNo = -1);
+    std::shared_ptr<ndn::Data> getPackage(ndn::Name &name,
+                                          const ndn::Block &content);
 
   private:
-    void digest(std::shared_ptr<ndn::Data> data);
+    void digest(std::shared_ptr<ndn::Data> data, bool versioned = false);
 
   private:
     const ndn::time::milliseconds m_freshnessPeriod;
+    const ndn::time::milliseconds m_versionedFreshnessPeriod;
 
     bool m_disableSigning;
     ndn::Signature m_fakeSignature;
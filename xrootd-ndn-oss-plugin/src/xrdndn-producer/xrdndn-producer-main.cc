@@ -96,6 +96,20 @@ int main(int argc, char **argv) {
         "accessed. Once the limit is reached and garbage-collector-timer "
         "triggers, the file will be closed")(
         "help,h", "Print this help message and exit")(
+        "inline-file-size",
+        boost::program_options::value<uint64_t>(&opts.inlineFileSize)
+            ->default_value(opts.inlineFileSize)
+            ->implicit_value(opts.inlineFileSize),
+        "Files up to this size in bytes get their first segment sent together "
+        "with the file stat in reply to a combined open Interest. 0 disables "
+        "inlining")(
+        "file-handles",
+        boost::program_options::value<uint32_t>(&opts.nFileHandles)
+            ->default_value(opts.nFileHandles)
+            ->implicit_value(opts.nFileHandles),
+        "Number of compact file handles returned in reply to combined open "
+        "Interests and used in read Interest Names instead of file paths. 0 "
+        "disables file handles")(
         "log-level",
         boost::program_options::value<std::string>(&logLevel)
             ->default_value(logLevel)
@@ -111,8 +125,18 @@ int main(int argc, char **argv) {
         "precache-files",
         boost::program_options::bool_switch(&opts.precacheFile),
         "Precache files in memory before responding to read Interests. For "
-        "performance testing only")("version,V",
-                                    "Show version information and exit");
+        "performance testing only")(
+        "synthetic", boost::program_options::bool_switch(&opts.synthetic),
+        "Serve virtual files /synthetic/<size>[K|M|G|T]/<seed> with content "
+        "generated on the fly, without touching storage. For performance "
+        "testing only")(
+        "versioned-freshness-period",
+        boost::program_options::value<uint64_t>(&opts.versionedFreshnessPeriod)
+            ->default_value(opts.versionedFreshnessPeriod)
+            ->implicit_value(opts.versionedFreshnessPeriod),
+        "Freshness period in seconds of file segments requested by file "
+        "version or file handle, whose content never changes")(
+        "version,V", "Show version information and exit");
 
     boost::program_options::variables_map vm;
     try {
@@ -132,6 +156,7 @@ int main(int argc, char **argv) {
 
     opts.gbTimer = std::chrono::seconds(opts.gbTimePeriod);
     opts.freshnessPeriod *= 1000;
+    opts.versionedFreshnessPeriod *= 1000;
 
     std::string programName = argv[0];
 
@@ -181,12 +206,17 @@ int main(int argc, char **argv) {
             << boostBuildInfo << ", with " << ndnCxxInfo);
         NDN_LOG_INFO("Selected Options: Freshness period: "
                      << opts.freshnessPeriod
+                     << "msec, Versioned freshness period: "
+                     << opts.versionedFreshnessPeriod
                      << "msec, Garbage collector timer: " << opts.gbTimePeriod
                      << "sec, Garbage collector lifetime: "
                      << opts.gbFileLifeTime
                      << "sec, Number of threads: " << opts.nthreads
                      << ", Pre-cache files: " << opts.precacheFile
-                     << ", Disable SHA-256 signing: " << opts.disableSigning);
+                     << ", Disable SHA-256 signing: " << opts.disableSigning
+                     << ", Inline file size: " << opts.inlineFileSize
+                     << ", File handles: " << opts.nFileHandles
+                     << ", Synthetic files: " << opts.synthetic);
     }
 
     return run(opts);
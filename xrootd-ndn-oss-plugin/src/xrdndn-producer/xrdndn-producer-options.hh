@@ -41,6 +41,14 @@ struct Options {
      */
     uint64_t freshnessPeriod = 32;
 
+    /**
+     * @brief Freshness period in seconds of file segments whose Name carries
+     * the file version. Their content never changes, so forwarders may keep
+     * serving them from cache for long
+     *
+     */
+    uint64_t versionedFreshnessPeriod = 3600;
+
     /**
      * @brief The time period in seconds as uint32_t when Garbage Collector
      * boost system timer from Interest Manager will be executed
@@ -78,6 +86,30 @@ struct Options {
      *
      */
     bool precacheFile = false;
+
+    /**
+     * @brief Files up to this size in bytes get their first segment inlined
+     * in the reply to a combined open Interest, next to the file stat
+     *
+     */
+    uint64_t inlineFileSize = 1048576;
+
+    /**
+     * @brief The number of file handles kept. A handle is returned with the
+     * reply to a combined open Interest and replaces the file path in read
+     * Interest Names. The oldest handle is reused when all are taken. 0
+     * disables file handles
+     *
+     */
+    uint32_t nFileHandles = 16384;
+
+    /**
+     * @brief Serve virtual files under /synthetic/<size>/<seed> whose content
+     * is generated from the seed and offset instead of read from storage.
+     * This option is only for performance testing and validation
+     *
+     */
+    bool synthetic = false;
 };
 } // namespace xrdndnproducer
 
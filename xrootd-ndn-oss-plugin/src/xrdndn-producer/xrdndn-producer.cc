@@ -65,6 +65,7 @@ Producer::~Producer() {
     m_openFilterHandle.cancel();
     m_fstatFilterHandle.cancel();
     m_readFilterHandle.cancel();
+    m_openStatFilterHandle.cancel();
     m_face.shutdown();
 }
 
@@ -102,6 +103,13 @@ void Producer::registerPrefix() {
         m_face.setInterestFilter(xrdndn::SYS_CALL_READ_PREFIX_URI,
                                  bind(&Producer::onReadInterest, this, _1, _2));
     NDN_LOG_INFO("Set Interest filter: " << xrdndn::SYS_CALL_READ_PREFIX_URI);
+
+    // Filter for the combined open, fstat and leading segment read
+    m_openStatFilterHandle = m_face.setInterestFilter(
+        xrdndn::SYS_CALL_OPEN_STAT_PREFIX_URI,
+        bind(&Producer::onOpenStatInterest, this, _1, _2));
+    NDN_LOG_INFO(
+        "Set Interest filter: " << xrdndn::SYS_CALL_OPEN_STAT_PREFIX_URI);
 }
 
 void Producer::onData(std::shared_ptr<ndn::Data> data) {
@@ -126,4 +134,10 @@ void Producer::onReadInterest(const InterestFilter &,
     NDN_LOG_TRACE("onReadInterest: " << interest);
     m_interestManager->readInterest(interest);
 }
+
+void Producer::onOpenStatInterest(const InterestFilter &,
+                                  const Interest &interest) {
+    NDN_LOG_TRACE("onOpenStatInterest: " << interest);
+    m_interestManager->openStatInterest(interest);
+}
 } // namespace xrdndnproducer
\ No newline at end of file
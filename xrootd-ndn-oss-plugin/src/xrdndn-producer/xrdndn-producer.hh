@@ -50,6 +50,9 @@ class Producer : boost::noncopyable {
     void onReadInterest(const ndn::InterestFilter &,
                         const ndn::Interest &interest);
 
+    void onOpenStatInterest(const ndn::InterestFilter &,
+                            const ndn::Interest &interest);
+
   private:
     ndn::Face &m_face;
     bool m_error;
@@ -58,6 +61,7 @@ class Producer : boost::noncopyable {
     ndn::InterestFilterHandle m_openFilterHandle;
     ndn::InterestFilterHandle m_fstatFilterHandle;
     ndn::InterestFilterHandle m_readFilterHandle;
+    ndn::InterestFilterHandle m_openStatFilterHandle;
 
     std::shared_ptr<InterestManager> m_interestManager;
 };
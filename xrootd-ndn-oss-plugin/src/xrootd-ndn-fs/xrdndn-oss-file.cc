@@ -60,16 +60,40 @@ ssize_t XrdNdnOssFile::Read(void *buff, off_t offset, size_t blen) {
     return retRead;
 }
 
-ssize_t XrdNdnOssFile::Read(off_t, size_t) { return XrdOssOK; }
+// Preread hint: the range is fetched in background into the segment store
+ssize_t XrdNdnOssFile::Read(off_t offset, size_t blen) {
+    m_consumer->Preread(offset, blen);
+    return XrdOssOK;
+}
 
 ssize_t XrdNdnOssFile::ReadRaw(void *buff, off_t offset, size_t blen) {
     return Read(buff, offset, blen);
 }
 
+// The segments of all chunks are requested at once, instead of one round trip
+// per chunk as the default implementation does
+ssize_t XrdNdnOssFile::ReadV(XrdOucIOVec *readV, int rdvcnt) {
+    std::vector<xrdndnconsumer::Consumer::ReadChunk> chunks(rdvcnt);
+    for (int i = 0; i < rdvcnt; ++i) {
+        chunks[i].buff = readV[i].data;
+        chunks[i].offset = readV[i].offset;
+        chunks[i].blen = readV[i].size;
+    }
+
+    return m_consumer->ReadV(chunks.data(), chunks.size());
+}
+
+// The request is completed from the NDN Face thread, so the XRootD worker
+// thread is free as soon as the Interests are handed over to the Pipeline
 int XrdNdnOssFile::Read(XrdSfsAio *aiop) {
-    aiop->Result = this->Read((void *)aiop->sfsAio.aio_buf,
-                              aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
-    aiop->doneRead();
+    m_pendingAio.add();
+    m_consumer->ReadAsync((void *)aiop->sfsAio.aio_buf,
+                          aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes,
+                          [this, aiop](ssize_t retRead) {
+                              aiop->Result = retRead;
+                              aiop->doneRead();
+                              m_pendingAio.countDown();
+                          });
     return 0;
 }
 
@@ -77,6 +101,7 @@ int XrdNdnOssFile::Read(XrdSfsAio *aiop) {
 /*                                 C l o s e                                 */
 /*****************************************************************************/
 int XrdNdnOssFile::Close(long long *) {
+    m_pendingAio.wait();
     m_consumer->Close();
     return 0;
 }
@@ -40,6 +40,7 @@ class XrdNdnOssFile : public XrdOssDF {
     ssize_t Read(void *, off_t, size_t);
     int Read(XrdSfsAio *aoip);
     ssize_t ReadRaw(void *, off_t, size_t);
+    ssize_t ReadV(XrdOucIOVec *readV, int rdvcnt);
     int Close(long long *retsz = 0);
 
   public:
@@ -56,6 +57,9 @@ class XrdNdnOssFile : public XrdOssDF {
   private:
     std::shared_ptr<xrdndnconsumer::Consumer> m_consumer;
     XrdNdnOss *m_xrdndnoss;
+
+    // Asynchronous reads not completed yet. Close waits for them
+    xrdndnconsumer::CountdownLatch m_pendingAio;
 };
 
 #endif // XRDNDN_OSS_FILE_HH
\ No newline at end of file
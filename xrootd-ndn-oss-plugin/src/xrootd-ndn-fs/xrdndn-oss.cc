@@ -68,6 +68,21 @@ XrdOss *XrdOssGetStorageSystem(XrdOss *, XrdSysLogger *Logger,
     XrdNdnSS.m_eDest->Say(
         "       ofs NDN Consumer interest lifetime: ",
         std::to_string(XrdNdnSS.m_consumerOptions.interestLifetime).c_str());
+    XrdNdnSS.m_eDest->Say(
+        "       ofs NDN Consumer readahead: ",
+        std::to_string(XrdNdnSS.m_consumerOptions.readahead).c_str());
+    XrdNdnSS.m_eDest->Say(
+        "       ofs NDN Consumer combined open: ",
+        std::to_string(XrdNdnSS.m_consumerOptions.combinedOpen).c_str());
+    XrdNdnSS.m_eDest->Say(
+        "       ofs NDN Consumer file handles: ",
+        std::to_string(XrdNdnSS.m_consumerOptions.fileHandles).c_str());
+    XrdNdnSS.m_eDest->Say(
+        "       ofs NDN Consumer hedge percentile: ",
+        std::to_string(XrdNdnSS.m_consumerOptions.hedgePercentile).c_str());
+    XrdNdnSS.m_eDest->Say(
+        "       ofs NDN Consumer hedge budget: ",
+        std::to_string(XrdNdnSS.m_consumerOptions.hedgeBudget).c_str());
     XrdNdnSS.m_eDest->Say("       ofs NDN Consumer log level: ",
                           XrdNdnSS.m_consumerOptions.logLevel.c_str());
     XrdNdnSS.m_eDest->Say(
@@ -113,6 +128,22 @@ void XrdNdnOss::Configure(const char *parms) {
         return false;
     };
 
+    auto getDoubleFromParams = [&](std::string key, double &ret) {
+        for (auto it = vparms.begin(); it != vparms.end(); ++it) {
+            if (key.compare(*it) != 0)
+                continue;
+            try {
+                ret = std::stod(*++it);
+                return true;
+            } catch (const std::exception &e) {
+                m_eDest->Emsg("Config", e.what(),
+                              "while getting double value from params list");
+                return false;
+            }
+        }
+        return false;
+    };
+
     auto getLogLevelFromParams = [&](std::string &logLevel) {
         std::string key("loglevel");
         for (auto it = vparms.begin(); it != vparms.end(); ++it) {
@@ -174,6 +205,86 @@ void XrdNdnOss::Configure(const char *parms) {
         }
     }
 
+    {
+        int readahead;
+        if (getIntFromParams("readahead", readahead)) {
+            if (readahead < XRDNDN_MINREADAHEAD ||
+                readahead > XRDNDN_MAXREADAHEAD) {
+                m_eDest->Emsg(
+                    "Config",
+                    std::string(
+                        "Readahead must be between " +
+                        std::to_string(XRDNDN_MINREADAHEAD) + " and " +
+                        std::to_string(XRDNDN_MAXREADAHEAD) +
+                        ". The readahead will be set to default value")
+                        .c_str());
+            } else {
+                m_consumerOptions.readahead = readahead;
+            }
+        }
+    }
+
+    {
+        int combinedOpen;
+        if (getIntFromParams("combinedopen", combinedOpen)) {
+            if (combinedOpen != 0 && combinedOpen != 1) {
+                m_eDest->Emsg("Config",
+                              "Combined open must be 0 or 1. Combined open "
+                              "will be set to default value 0");
+            } else {
+                m_consumerOptions.combinedOpen = combinedOpen;
+            }
+        }
+    }
+
+    {
+        int fileHandles;
+        if (getIntFromParams("filehandles", fileHandles)) {
+            if (fileHandles != 0 && fileHandles != 1) {
+                m_eDest->Emsg("Config",
+                              "File handles must be 0 or 1. File handles will "
+                              "be set to default value 0");
+            } else {
+                m_consumerOptions.fileHandles = fileHandles;
+            }
+        }
+    }
+
+    {
+        double hedgePercentile;
+        if (getDoubleFromParams("hedgepercentile", hedgePercentile)) {
+            if (hedgePercentile != 0 &&
+                (hedgePercentile < XRDNDN_MINHEDGE_PERCENTILE ||
+                 hedgePercentile > XRDNDN_MAXHEDGE_PERCENTILE)) {
+                std::ostringstream msg;
+                msg << "Hedge percentile must be 0 or between "
+                    << XRDNDN_MINHEDGE_PERCENTILE << " and "
+                    << XRDNDN_MAXHEDGE_PERCENTILE
+                    << ". Hedging will be disabled";
+                m_eDest->Emsg("Config", msg.str().c_str());
+            } else {
+                m_consumerOptions.hedgePercentile = hedgePercentile;
+            }
+        }
+    }
+
+    {
+        double hedgeBudget;
+        if (getDoubleFromParams("hedgebudget", hedgeBudget)) {
+            if (hedgeBudget < 0 || hedgeBudget > XRDNDN_MAXHEDGE_BUDGET) {
+                m_eDest->Emsg(
+                    "Config",
+                    std::string(
+                        "Hedge budget must be between 0 and " +
+                        std::to_string(XRDNDN_MAXHEDGE_BUDGET) +
+                        ". The hedge budget will be set to default value")
+                        .c_str());
+            } else {
+                m_consumerOptions.hedgeBudget = hedgeBudget;
+            }
+        }
+    }
+
     {
         std::string logLevel;
         if (getLogLevelFromParams(logLevel)) {